@@ -0,0 +1,61 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <Affinity.hpp>
+#include <omp.h>
+#include <sched.h>
+
+namespace mpi = boost::mpi;
+
+void Affinity::pin_threads()
+{
+	if (omp_get_proc_bind() != omp_proc_bind_false) {
+		return;
+	}
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed)) {
+		return;
+	}
+	std::vector<int> cpus;
+	for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (CPU_ISSET(cpu, &allowed)) {
+			cpus.push_back(cpu);
+		}
+	}
+	if (cpus.empty()) {
+		return;
+	}
+#pragma omp parallel
+{
+	cpu_set_t target;
+	CPU_ZERO(&target);
+	CPU_SET(cpus[omp_get_thread_num() % cpus.size()], &target);
+	sched_setaffinity(0, sizeof(target), &target);
+}
+}
+
+void Affinity::report(mpi::communicator world)
+{
+	const int nthreads = omp_get_max_threads();
+	std::vector<unsigned int> cpus(nthreads), nodes(nthreads);
+#pragma omp parallel
+{
+	const auto t = omp_get_thread_num();
+	getcpu(&cpus[t], &nodes[t]);
+}
+	std::ostringstream description;
+	description << mpi::environment::processor_name() << " rank " << world.rank() << ":";
+	for (int t = 0; t < nthreads; t++) {
+		description << " " << t << "->cpu" << cpus[t] << "/node" << nodes[t];
+	}
+	std::vector<std::string> descriptions;
+	mpi::gather(world, description.str(), descriptions, 0);
+	if (!world.rank()) {
+		std::cout << "Binding: " << (omp_get_proc_bind() != omp_proc_bind_false ? "OpenMP runtime" : "explicit") << std::endl;
+		for (const auto& line : descriptions) {
+			std::cout << line << std::endl;
+		}
+	}
+}
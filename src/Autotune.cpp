@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <Autotune.hpp>
+#include <unistd.h>
+
+#define AUTOTUNE_TIME_BLOCKS	{ 2U, 4U, 8U, 16U }
+
+std::vector<Autotune::Configuration> Autotune::candidates(unsigned int max_threads, unsigned long automatic_strip_width,
+														unsigned long row_length)
+{
+	std::vector<unsigned long> widths{ automatic_strip_width / 2, automatic_strip_width, automatic_strip_width * 2, row_length };
+	widths.erase(std::remove_if(widths.begin(), widths.end(), [row_length](unsigned long width) {
+		return !width || width > row_length;
+	}), widths.end());
+	std::sort(widths.begin(), widths.end());
+	widths.erase(std::unique(widths.begin(), widths.end()), widths.end());
+
+	std::vector<Configuration> configurations;
+	for (auto threads = max_threads; threads; threads /= 2) {
+		// only the static evolution walks the rows in strips
+		for (const auto width : widths) {
+			configurations.push_back({ 1, threads, width, 0, 0.0 });
+		}
+		configurations.push_back({ 2, threads, row_length, 0, 0.0 });
+		configurations.push_back({ 3, threads, row_length, 0, 0.0 });
+		for (const auto time_block : AUTOTUNE_TIME_BLOCKS) {
+			configurations.push_back({ 5, threads, row_length, time_block, 0.0 });
+		}
+	}
+	return configurations;
+}
+
+std::string Autotune::cache_path()
+{
+	const char *cache_home = std::getenv("XDG_CACHE_HOME");
+	const char *home = std::getenv("HOME");
+	std::filesystem::path directory = cache_home && *cache_home ? std::filesystem::path{cache_home}
+		: std::filesystem::path{home ? home : "."} / ".cache";
+	char hostname[256] = "";
+	gethostname(hostname, sizeof(hostname) - 1);
+	return (directory / "gol" / (std::string{"autotune-"} + hostname)).string();
+}
+
+std::string Autotune::machine_key(unsigned long grid_size, int ranks, unsigned int threads)
+{
+	std::ifstream cpuinfo{"/proc/cpuinfo"};
+	std::string model = "unknown";
+	for (std::string line; std::getline(cpuinfo, line);) {
+		if (line.rfind("model name", 0) == 0) {
+			model = line.substr(line.find(':') + 2);
+			break;
+		}
+	}
+	std::ostringstream key;
+	key << model << "\t" << sysconf(_SC_NPROCESSORS_ONLN) << "\t" << grid_size << "\t" << ranks << "\t" << threads;
+	return key.str();
+}
+
+bool Autotune::lookup(const std::string& path, const std::string& key, Configuration& configuration)
+{
+	std::ifstream cache{path};
+	for (std::string line; std::getline(cache, line);) {
+		if (line.compare(0, key.size() + 1, key + "\t")) {
+			continue;
+		}
+		std::istringstream fields{line.substr(key.size() + 1)};
+		if (fields >> configuration.engine >> configuration.threads >> configuration.strip_width
+			>> configuration.time_block >> configuration.seconds) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Autotune::store(const std::string& path, const std::string& key, const Configuration& configuration)
+{
+	std::vector<std::string> lines;
+	{
+		std::ifstream cache{path};
+		for (std::string line; std::getline(cache, line);) {
+			if (line.compare(0, key.size() + 1, key + "\t")) {
+				lines.push_back(line);
+			}
+		}
+	}
+	std::ostringstream line;
+	line << key << "\t" << configuration.engine << "\t" << configuration.threads << "\t" << configuration.strip_width
+		<< "\t" << configuration.time_block << "\t" << configuration.seconds;
+	lines.push_back(line.str());
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path{path}.parent_path(), error);
+	// written aside and renamed, so that concurrent runs never read a partial cache
+	const auto temporary = path + "." + std::to_string(getpid());
+	{
+		std::ofstream cache{temporary, std::ios_base::trunc};
+		for (const auto& kept : lines) {
+			cache << kept << "\n";
+		}
+		if (!cache) {
+			return false;
+		}
+	}
+	std::filesystem::rename(temporary, path, error);
+	return !error;
+}
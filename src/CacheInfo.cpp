@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <CacheInfo.hpp>
+#include <unistd.h>
+
+#define FALLBACK_CACHE_SIZE	(32UL * 1024)
+#define STRIP_ALIGNMENT		64UL
+
+// sizes in sysfs look like "48K"
+static unsigned long sysfs_cache_size(unsigned int level)
+{
+	for (unsigned int index = 0; ; index++) {
+		const std::string directory = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/";
+		std::ifstream level_file{directory + "level"};
+		if (!level_file) {
+			return 0;
+		}
+		unsigned int cache_level;
+		std::string type, size;
+		level_file >> cache_level;
+		std::ifstream{directory + "type"} >> type;
+		std::ifstream{directory + "size"} >> size;
+		if (cache_level != level || type == "Instruction" || size.empty()) {
+			continue;
+		}
+		unsigned long bytes = std::stoul(size);
+		if (size.back() == 'K') {
+			bytes *= 1024;
+		} else if (size.back() == 'M') {
+			bytes *= 1024 * 1024;
+		}
+		return bytes;
+	}
+}
+
+unsigned long CacheInfo::data_cache_size(unsigned int level)
+{
+	long size = 0;
+	if (level == 1) {
+		size = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+	} else if (level == 2) {
+		size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+	} else if (level == 3) {
+		size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+	}
+	return size > 0 ? static_cast<unsigned long>(size) : sysfs_cache_size(level);
+}
+
+static unsigned long per_core_cache_size()
+{
+	unsigned long cache = CacheInfo::data_cache_size(2);
+	if (!cache) {
+		cache = CacheInfo::data_cache_size(1);
+	}
+	return cache ? cache : FALLBACK_CACHE_SIZE;
+}
+
+unsigned long CacheInfo::strip_width(unsigned long row_length)
+{
+	const unsigned long cache = per_core_cache_size();
+	const unsigned long width = std::max(cache / 2 / 4 / STRIP_ALIGNMENT * STRIP_ALIGNMENT, STRIP_ALIGNMENT);
+	return std::min(width, row_length);
+}
+
+unsigned long CacheInfo::tile_rows(unsigned long row_stride, unsigned int generations)
+{
+	// the tiles shrink by one row per generation on either side
+	return std::max(per_core_cache_size() / 2 / 2 / row_stride, 2UL * generations);
+}
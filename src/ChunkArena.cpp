@@ -0,0 +1,46 @@
+#include <ChunkArena.hpp>
+
+ChunkArena::ChunkArena(ChunkMemory *upstream)
+	: source{upstream}, reused{0}
+{
+}
+
+ChunkArena::~ChunkArena()
+{
+	release_cached();
+}
+
+void ChunkArena::release_cached()
+{
+	for (const auto& [bytes, ptr] : cached) {
+		if (source) {
+			source->deallocate(ptr, bytes);
+		} else {
+			boost::alignment::aligned_free(ptr);
+		}
+	}
+	cached.clear();
+}
+
+void *ChunkArena::allocate(std::size_t bytes)
+{
+	const auto block = cached.find(bytes);
+	if (block != cached.end()) {
+		void *ptr = block->second;
+		cached.erase(block);
+		reused++;
+		return ptr;
+	}
+	release_cached();
+	return source ? source->allocate(bytes) : boost::alignment::aligned_alloc(CHUNK_ALIGNMENT, bytes);
+}
+
+void ChunkArena::deallocate(void *ptr, std::size_t bytes)
+{
+	cached.emplace(bytes, ptr);
+}
+
+unsigned long ChunkArena::hits() const
+{
+	return reused;
+}
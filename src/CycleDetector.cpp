@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <cstring>
+#include <CycleDetector.hpp>
+#include <omp.h>
+
+namespace mpi = boost::mpi;
+
+// splitmix64 finalizer
+inline __attribute__((always_inline)) std::uint64_t mix(std::uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+CycleDetector::CycleDetector(unsigned int period_bound, unsigned int check_interval)
+	: max_period{period_bound}, check_period{std::max(check_interval, 1U)},
+	hashes(period_bound + 1), hashed_steps(period_bound + 1, 0),
+	candidate_period{0}, verification_step{0}
+{
+}
+
+std::uint64_t CycleDetector::hash_chunk(const PGM_HOLDER& chunk, const unsigned long leading_halo_length)
+{
+	const unsigned char *cells = chunk.data() + leading_halo_length;
+	const unsigned long length = chunk.size() - 2 * leading_halo_length;
+	const unsigned long words = length / sizeof(std::uint64_t);
+	std::uint64_t hash = mix(length);
+	// position-salted words summed modulo 2^64, so the result does not depend on how the loop is split
+#pragma omp parallel for reduction(+:hash) schedule(static)
+	for (unsigned long w = 0; w < words; w++) {
+		std::uint64_t word;
+		std::memcpy(&word, cells + w * sizeof(std::uint64_t), sizeof(std::uint64_t));
+		hash += mix(word ^ (w * 0x9e3779b97f4a7c15ULL));
+	}
+	for (unsigned long i = words * sizeof(std::uint64_t); i < length; i++) {
+		hash += mix(cells[i] ^ (i * 0x9e3779b97f4a7c15ULL));
+	}
+	return hash;
+}
+
+void CycleDetector::reset()
+{
+	std::fill(hashed_steps.begin(), hashed_steps.end(), 0);
+	candidate_period = 0;
+	PGM_HOLDER{}.swap(candidate_chunk);
+}
+
+bool CycleDetector::wants_hash(const unsigned int step) const
+{
+	const auto distance_to_check = (check_period - step % check_period) % check_period;
+	return distance_to_check <= max_period;
+}
+
+bool CycleDetector::observes(const unsigned int step) const
+{
+	return max_period && (candidate_period ? step == verification_step : wants_hash(step));
+}
+
+unsigned int CycleDetector::observe(const PGM_HOLDER& chunk, const unsigned long leading_halo_length,
+									const unsigned int step, mpi::communicator world)
+{
+	if (!max_period) {
+		return 0;
+	}
+	if (candidate_period) {
+		if (step != verification_step) {
+			return 0;
+		}
+		const bool identical = std::equal(chunk.begin() + leading_halo_length, chunk.end() - leading_halo_length,
+										candidate_chunk.begin() + leading_halo_length);
+		const int confirmed = mpi::all_reduce(world, int(identical), mpi::minimum<int>());
+		const auto period = candidate_period;
+		candidate_period = 0;
+		PGM_HOLDER{}.swap(candidate_chunk);
+		return confirmed ? period : 0;
+	}
+	if (!wants_hash(step)) {
+		return 0;
+	}
+	const auto slot = step % (max_period + 1);
+	hashes[slot] = hash_chunk(chunk, leading_halo_length);
+	hashed_steps[slot] = step;
+	if (step % check_period) {
+		return 0;
+	}
+	std::vector<int> local_matches(max_period), global_matches(max_period);
+	for (unsigned int p = 1; p <= max_period; p++) {
+		const auto past_slot = (step - p) % (max_period + 1);
+		local_matches[p - 1] = p < step && hashed_steps[past_slot] == step - p && hashes[past_slot] == hashes[slot];
+	}
+	mpi::all_reduce(world, local_matches.data(), int(max_period), global_matches.data(), mpi::minimum<int>());
+	const auto match = std::find(global_matches.begin(), global_matches.end(), 1);
+	if (match != global_matches.end()) {
+		candidate_period = unsigned(match - global_matches.begin()) + 1;
+		verification_step = step + candidate_period;
+		candidate_chunk = chunk;
+	}
+	return 0;
+}
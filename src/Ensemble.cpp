@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <random>
+#include <Ensemble.hpp>
+#include <PgmUtils.hpp>
+
+#define WORDS_PER_LINE	(CHUNK_ALIGNMENT / sizeof(std::uint64_t))
+
+Ensemble::Ensemble(unsigned long size, std::uint64_t first_seed)
+	: grid_size{size}, stride{(size + 2 + WORDS_PER_LINE - 1) / WORDS_PER_LINE * WORDS_PER_LINE},
+	current((size + 2) * stride), next((size + 2) * stride), step{0}
+{
+	std::fill(current.begin(), current.end(), 0);
+	std::fill(next.begin(), next.end(), 0);
+	for (unsigned int u = 0; u < ENSEMBLE_UNIVERSES; u++) {
+		std::mt19937_64 generator(first_seed + u);
+		for (auto row = 1UL; row <= grid_size; row++) {
+			for (auto column = 1UL; column <= grid_size; column++) {
+				current[row * stride + column] |= std::uint64_t(PgmUtils::random_cell(generator)) << u;
+			}
+		}
+	}
+	for (auto row = 1UL; row <= grid_size; row++) {
+		current[row * stride] = current[row * stride + grid_size];
+		current[row * stride + grid_size + 1] = current[row * stride + 1];
+	}
+	refresh_ghost_rows(current.data());
+	initial_population = population();
+	extinction_step.fill(0);
+	still_step.fill(0);
+}
+
+void Ensemble::refresh_ghost_rows(std::uint64_t *cells) const
+{
+	std::copy(cells + grid_size * stride, cells + (grid_size + 1) * stride, cells);
+	std::copy(cells + stride, cells + 2 * stride, cells + (grid_size + 1) * stride);
+}
+
+void Ensemble::evolve()
+{
+	const std::uint64_t *cells = current.data();
+	std::uint64_t *next_cells = next.data();
+	std::uint64_t alive = 0, changed = 0;
+#pragma omp parallel for schedule(static) reduction(|:alive, changed)
+	for (auto row = 1UL; row <= grid_size; row++) {
+		const std::uint64_t *up = cells + (row - 1) * stride;
+		const std::uint64_t *mid = cells + row * stride;
+		const std::uint64_t *down = cells + (row + 1) * stride;
+		std::uint64_t *out = next_cells + row * stride;
+		for (auto c = 1UL; c <= grid_size; c++) {
+			const std::uint64_t neighbors[8] = { up[c - 1], up[c], up[c + 1], mid[c - 1], mid[c + 1], down[c - 1], down[c], down[c + 1] };
+			// per-universe counters: ones and twos hold the count modulo 4, four_or_more saturates
+			std::uint64_t ones = 0, twos = 0, four_or_more = 0;
+			for (const auto neighbor : neighbors) {
+				const std::uint64_t carry = ones & neighbor;
+				ones ^= neighbor;
+				four_or_more |= twos & carry;
+				twos ^= carry;
+			}
+			// alive with 2 or 3 neighbors, whatever the current state
+			out[c] = twos & ~four_or_more;
+			alive |= out[c];
+			changed |= out[c] ^ mid[c];
+		}
+		out[0] = out[grid_size];
+		out[grid_size + 1] = out[1];
+	}
+	refresh_ghost_rows(next_cells);
+	current.swap(next);
+	step++;
+	for (unsigned int u = 0; u < ENSEMBLE_UNIVERSES; u++) {
+		if (!extinction_step[u] && !(alive >> u & 1)) {
+			extinction_step[u] = step;
+		}
+		if (!still_step[u] && !(changed >> u & 1)) {
+			still_step[u] = step;
+		}
+	}
+}
+
+bool Ensemble::settled() const
+{
+	return std::all_of(still_step.begin(), still_step.end(), [](unsigned int s) { return s != 0; });
+}
+
+std::array<unsigned long, ENSEMBLE_UNIVERSES> Ensemble::population() const
+{
+	std::array<unsigned long, ENSEMBLE_UNIVERSES> count{};
+	for (auto row = 1UL; row <= grid_size; row++) {
+		for (auto c = 1UL; c <= grid_size; c++) {
+			for (auto word = current[row * stride + c]; word; word &= word - 1) {
+				count[__builtin_ctzll(word)]++;
+			}
+		}
+	}
+	return count;
+}
+
+std::array<Ensemble::Statistics, ENSEMBLE_UNIVERSES> Ensemble::statistics() const
+{
+	const auto final_population = population();
+	std::array<Statistics, ENSEMBLE_UNIVERSES> result;
+	for (unsigned int u = 0; u < ENSEMBLE_UNIVERSES; u++) {
+		result[u] = { initial_population[u], final_population[u], extinction_step[u], still_step[u] };
+	}
+	return result;
+}
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <FrameRing.hpp>
+
+static inline std::uint64_t *published_of(unsigned char *mapping, int rank)
+{
+	return reinterpret_cast<std::uint64_t*>(mapping + (rank + 1) * CHUNK_ALIGNMENT);
+}
+
+FrameRing::FrameRing(const std::string& name, unsigned long size, unsigned int slots, unsigned int scale, bool bits, MPI_Comm comm)
+	: grid_size{size}, bytes{0}, mapping{nullptr}, header{}, frames{0}
+{
+	int ranks, node_ranks;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &ranks);
+	MPI_Comm node_comm;
+	MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node_comm);
+	MPI_Comm_size(node_comm, &node_ranks);
+	MPI_Comm_free(&node_comm);
+
+	std::memcpy(header.magic, FRAME_RING_MAGIC, sizeof(header.magic));
+	header.scale = std::max(scale, 1U);
+	header.width = std::uint32_t((grid_size + header.scale - 1) / header.scale);
+	header.height = header.width;
+	header.bits = bits ? 1 : 8;
+	header.slots = std::max(slots, 1U);
+	header.ranks = std::uint32_t(ranks);
+	header.row_bytes = bits ? (header.width + 7) / 8 : header.width;
+	const auto align = [](std::uint64_t n) { return (n + CHUNK_ALIGNMENT - 1) / CHUNK_ALIGNMENT * CHUNK_ALIGNMENT; };
+	header.slot_bytes = ranks * CHUNK_ALIGNMENT + align(header.row_bytes * header.height);
+	header.grid_size = grid_size;
+	bytes = std::size_t((1 + ranks) * CHUNK_ALIGNMENT + header.slots * header.slot_bytes);
+
+	// rank 0 creates the object and fills the header once everything else is zeroed
+	int ok = node_ranks == ranks;
+	if (!rank && ok) {
+		shm_unlink(name.c_str());
+		const int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+		ok = fd >= 0 && ftruncate(fd, off_t(bytes)) == 0;
+		if (ok) {
+			void *address = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			ok = address != MAP_FAILED;
+			mapping = ok ? static_cast<unsigned char*>(address) : nullptr;
+		}
+		if (!ok) {
+			std::perror(name.c_str());
+		}
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+	MPI_Bcast(&ok, 1, MPI_INT, 0, comm);
+	if (ok && rank) {
+		const int fd = shm_open(name.c_str(), O_RDWR, 0);
+		void *address = fd >= 0 ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+		mapping = address != MAP_FAILED ? static_cast<unsigned char*>(address) : nullptr;
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+	int mapped = ok && mapping;
+	MPI_Allreduce(MPI_IN_PLACE, &mapped, 1, MPI_INT, MPI_MIN, comm);
+	if (!mapped && mapping) {
+		munmap(mapping, bytes);
+		mapping = nullptr;
+	}
+	if (mapping && !rank) {
+		std::memcpy(mapping, &header, sizeof(header));
+	}
+}
+
+FrameRing::~FrameRing()
+{
+	// the object stays around for the viewers, with the last frames
+	if (mapping) {
+		munmap(mapping, bytes);
+	}
+}
+
+bool FrameRing::ready() const
+{
+	return mapping;
+}
+
+void FrameRing::publish(const PGM_HOLDER& chunk, unsigned long first_row, unsigned long step)
+{
+	const auto stride = PgmUtils::row_stride(grid_size);
+	const auto end_row = first_row + chunk.size() / stride - 2;
+	unsigned char *slot = mapping + (1 + header.ranks) * CHUNK_ALIGNMENT + (frames % header.slots) * header.slot_bytes;
+	auto *band = reinterpret_cast<Band*>(slot + rank * CHUNK_ALIGNMENT);
+	unsigned char *rows = slot + header.ranks * CHUNK_ALIGNMENT;
+
+	__atomic_store_n(&band->sequence, 2 * frames + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	band->step = step;
+	const long first_frame_row = long((first_row + header.scale - 1) / header.scale);
+	const long end_frame_row = long((end_row + header.scale - 1) / header.scale);
+#pragma omp parallel for schedule(static)
+	for (long y = first_frame_row; y < end_frame_row; y++) {
+		const unsigned char *cells = chunk.data() + (y * header.scale - first_row + 1) * stride + 1;
+		unsigned char *pixels = rows + y * header.row_bytes;
+		if (header.bits == 8) {
+			for (unsigned long x = 0; x < header.width; x++) {
+				pixels[x] = cells[x * header.scale];
+			}
+		} else {
+			std::memset(pixels, 0, header.row_bytes);
+			for (unsigned long x = 0; x < header.width; x++) {
+				pixels[x / 8] |= (cells[x * header.scale] == PGM_MAX_VALUE) << (x % 8);
+			}
+		}
+	}
+	__atomic_store_n(&band->sequence, 2 * frames + 2, __ATOMIC_RELEASE);
+	frames++;
+	__atomic_store_n(published_of(mapping, rank), frames, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,292 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <omp.h>
+#include <CacheInfo.hpp>
+#include <Gol.hpp>
+#include <Trace.hpp>
+
+std::pair<unsigned long, unsigned long> Gol::band_of(unsigned long height, MPI_Comm comm)
+{
+	int rank = 0, ranks = 1;
+	if (comm != MPI_COMM_NULL) {
+		MPI_Comm_rank(comm, &rank);
+		MPI_Comm_size(comm, &ranks);
+	}
+	const auto r = unsigned(rank), n = unsigned(ranks);
+	const auto leftovers = height % n;
+	return { height / n + (r < leftovers), height / n * r + std::min<unsigned long>(r, leftovers) };
+}
+
+Gol::Grid::Grid(unsigned long grid_width, unsigned long band_rows, unsigned long band_first_row, ChunkMemory *memory)
+	: length{grid_width}, height{band_rows}, offset{band_first_row}, cells{PgmUtils::allocate_chunk(band_rows, grid_width, memory)}
+{
+}
+
+unsigned long Gol::Grid::width() const
+{
+	return length;
+}
+
+unsigned long Gol::Grid::rows() const
+{
+	return height;
+}
+
+unsigned long Gol::Grid::first_row() const
+{
+	return offset;
+}
+
+unsigned char *Gol::Grid::row(unsigned long r)
+{
+	return cells.data() + (r + 1) * PgmUtils::row_stride(length) + 1;
+}
+
+const unsigned char *Gol::Grid::row(unsigned long r) const
+{
+	return cells.data() + (r + 1) * PgmUtils::row_stride(length) + 1;
+}
+
+void Gol::Grid::refresh()
+{
+	for (unsigned long r = 0; r < height; r++) {
+		PgmUtils::refresh_ghost_cells(row(r) - 1, length);
+	}
+}
+
+void Gol::Grid::load(const unsigned char *dense)
+{
+	for (unsigned long r = 0; r < height; r++) {
+		std::memcpy(row(r), dense + r * length, length);
+	}
+	refresh();
+}
+
+void Gol::Grid::store(unsigned char *dense) const
+{
+	for (unsigned long r = 0; r < height; r++) {
+		std::memcpy(dense + r * length, row(r), length);
+	}
+}
+
+unsigned long Gol::Grid::population() const
+{
+	unsigned long alive = 0;
+	for (unsigned long r = 0; r < height; r++) {
+		alive += std::count(row(r), row(r) + length, CELL_ALIVE);
+	}
+	return alive;
+}
+
+PGM_HOLDER& Gol::Grid::chunk()
+{
+	return cells;
+}
+
+const PGM_HOLDER& Gol::Grid::chunk() const
+{
+	return cells;
+}
+
+void Gol::Grid::move_to(ChunkMemory *memory)
+{
+	PGM_HOLDER moved = PgmUtils::allocate_chunk(height, length, memory, false);
+	std::copy(cells.begin(), cells.end(), moved.begin());
+	cells.swap(moved);
+}
+
+void Gol::Engine::evolve(Grid& current, Grid& next)
+{
+	evolve_chunk(current.chunk(), next.chunk(), current.width());
+}
+
+bool Gol::Engine::in_place() const
+{
+	return false;
+}
+
+namespace {
+
+// column strips walked down the rows of every thread, so that the rows of a strip stay in cache
+class StaticEngine : public Gol::Engine {
+public:
+	StaticEngine(unsigned int threads, unsigned long width)
+		: nthreads{threads}, fixed_strip_width{width}, strip_row_length{0}, strip_width{0}
+	{
+	}
+
+	void evolve_chunk(PGM_HOLDER& current, PGM_HOLDER& next, unsigned long row_length) override
+	{
+		if (row_length != strip_row_length) {
+			strip_row_length = row_length;
+			strip_width = fixed_strip_width ? std::min(fixed_strip_width, row_length) : CacheInfo::strip_width(row_length);
+		}
+		const auto stride = PgmUtils::row_stride(row_length);
+		const unsigned char *cells = current.data();
+		unsigned char *next_cells = next.data();
+		const auto rows = current.size() / stride - 2; // minus 2 halo rows
+#pragma omp parallel num_threads(nthreads)
+		{
+			Trace::Span span{"rows"};
+			const auto [row_begin, row_end] = PgmUtils::thread_slice(rows, unsigned(omp_get_thread_num()), unsigned(omp_get_num_threads()));
+			for (unsigned long strip = 1; strip <= row_length; strip += strip_width) {
+				const auto strip_end = std::min(strip + strip_width, row_length + 1);
+				for (auto row = row_begin + 1; row < row_end + 1; row++) {
+					const unsigned char *mid = cells + row * stride;
+					Gol::evolve_cells(mid - stride, mid, mid + stride, next_cells + row * stride, strip, strip_end);
+				}
+			}
+			for (auto row = row_begin + 1; row < row_end + 1; row++) {
+				PgmUtils::refresh_ghost_cells(next_cells + row * stride, row_length);
+			}
+		}
+	}
+
+	const char *name() const override
+	{
+		return "static";
+	}
+
+private:
+	unsigned int nthreads;
+	unsigned long fixed_strip_width;
+	unsigned long strip_row_length;
+	unsigned long strip_width;
+};
+
+/*
+ * Same results as StaticEngine, written over the current generation. Every thread saves the rows
+ * just outside its slice before any of them is overwritten, then walks its rows downwards keeping
+ * the original of the row above and of the row being written in two line buffers.
+ */
+class InPlaceEngine : public Gol::Engine {
+public:
+	explicit InPlaceEngine(unsigned int threads)
+		: nthreads{threads}
+	{
+	}
+
+	void evolve_chunk(PGM_HOLDER& current, PGM_HOLDER&, unsigned long row_length) override
+	{
+		const auto stride = PgmUtils::row_stride(row_length);
+		unsigned char *chunk = current.data();
+		const auto rows = current.size() / stride - 2;
+#pragma omp parallel num_threads(nthreads)
+		{
+			Trace::Span span{"rows"};
+			const auto [row_begin, row_end] = PgmUtils::thread_slice(rows, unsigned(omp_get_thread_num()), unsigned(omp_get_num_threads()));
+			std::vector<unsigned char> lines(3 * stride);
+			unsigned char *above = lines.data(), *original = above + stride, *below = original + stride;
+			std::memcpy(above, chunk + row_begin * stride, stride);
+			std::memcpy(below, chunk + (row_end + 1) * stride, stride);
+#pragma omp barrier
+			for (auto row = row_begin + 1; row < row_end + 1; row++) {
+				unsigned char *cells = chunk + row * stride;
+				std::memcpy(original, cells, stride);
+				Gol::evolve_cells(above, original, row == row_end ? below : cells + stride, cells, 1, row_length + 1);
+				PgmUtils::refresh_ghost_cells(cells, row_length);
+				std::swap(above, original);
+			}
+		}
+	}
+
+	bool in_place() const override
+	{
+		return true;
+	}
+
+	const char *name() const override
+	{
+		return "in-place";
+	}
+
+private:
+	unsigned int nthreads;
+};
+
+}
+
+std::unique_ptr<Gol::Engine> Gol::Engine::create(const std::string& name, unsigned int threads, unsigned long strip_width)
+{
+	if (!threads) {
+		threads = unsigned(omp_get_max_threads());
+	}
+	if (name == "static") {
+		return std::make_unique<StaticEngine>(threads, strip_width);
+	}
+	if (name == "in-place") {
+		return std::make_unique<InPlaceEngine>(threads);
+	}
+	return nullptr;
+}
+
+Gol::Simulation::Simulation(Grid& simulated, Engine& stepper, MPI_Comm comm, const std::string& halo_name)
+	: grid{simulated}, engine{stepper}, next{simulated.width(), simulated.rows(), simulated.first_row()}, generations{0}
+{
+	if (engine.in_place()) {
+		PGM_HOLDER{}.swap(next.chunk());
+	}
+	int ranks = 1;
+	if (comm != MPI_COMM_NULL) {
+		MPI_Comm_size(comm, &ranks);
+	}
+	if (ranks == 1) {
+		return;
+	}
+	int rank;
+	MPI_Comm_rank(comm, &rank);
+	halo = HaloExchange::create(halo_name, comm, (rank + ranks - 1) % ranks, (rank + 1) % ranks, PgmUtils::row_stride(grid.width()));
+	if (!halo) {
+		throw std::invalid_argument{"unknown halo exchange " + halo_name};
+	}
+	if (halo->memory()) {
+		if (engine.in_place()) {
+			throw std::invalid_argument{std::string{halo_name} + " cannot exchange the halos of " + engine.name()};
+		}
+		grid.move_to(halo->memory());
+		next.move_to(halo->memory());
+	}
+	halo->attach(grid.chunk(), next.chunk());
+}
+
+Gol::Simulation::~Simulation()
+{
+	if (halo && halo->memory()) {
+		// the caller keeps the grid, the memory goes away with the halo exchange
+		grid.move_to(nullptr);
+		PGM_HOLDER{}.swap(next.chunk());
+	}
+}
+
+void Gol::Simulation::on_frame(unsigned long period, Frame frame)
+{
+	frames.emplace_back(period, std::move(frame));
+}
+
+void Gol::Simulation::step(unsigned long n)
+{
+	for (unsigned long i = 0; i < n; i++) {
+		if (halo) {
+			halo->exchange(grid.chunk());
+		}
+		engine.evolve(grid, next);
+		if (halo) {
+			halo->publish();
+		}
+		if (!engine.in_place()) {
+			grid.chunk().swap(next.chunk());
+		}
+		generations++;
+		for (const auto& [period, frame] : frames) {
+			if (period && generations % period == 0) {
+				frame(generations, grid);
+			}
+		}
+	}
+}
+
+unsigned long Gol::Simulation::generation() const
+{
+	return generations;
+}
@@ -0,0 +1,396 @@
+#include <algorithm>
+#include <vector>
+#include <HaloExchange.hpp>
+#include <NodeSharedChunks.hpp>
+#include <Trace.hpp>
+
+inline unsigned long chunk_rows(const PGM_HOLDER& chunk, unsigned long row_length)
+{
+	return chunk.size() / row_length - 2; // minus 2 halo rows
+}
+
+HaloExchange::HaloExchange(MPI_Comm comm, int prev, int next, unsigned long length)
+	: world{comm}, prev_rank{prev}, next_rank{next}, row_length{length}, elapsed{0}
+{
+}
+
+ChunkMemory *HaloExchange::memory()
+{
+	return nullptr;
+}
+
+void HaloExchange::exchange(PGM_HOLDER& chunk)
+{
+	const double start = MPI_Wtime();
+	Trace::Span span{"halo exchange"};
+	exchange_rows(chunk);
+	elapsed += MPI_Wtime() - start;
+}
+
+void HaloExchange::publish()
+{
+}
+
+void HaloExchange::trace(Transfer transfer, double begin) const
+{
+	static const char *const names[] = { "send first row", "send last row", "receive top halo", "receive bottom halo" };
+	if (Trace::active) {
+		const auto k = static_cast<int>(transfer);
+		Trace::record(names[k], begin, MPI_Wtime(), k % 2 ? next_rank : prev_rank, row_length);
+	}
+}
+
+void HaloExchange::wait_all(int count, MPI_Request *requests, const Transfer *transfers, double begin) const
+{
+	if (!Trace::active) {
+		MPI_Waitall(count, requests, MPI_STATUSES_IGNORE);
+		return;
+	}
+	for (int index = 0; index != MPI_UNDEFINED;) {
+		MPI_Waitany(count, requests, &index, MPI_STATUS_IGNORE);
+		if (index != MPI_UNDEFINED) {
+			trace(transfers[index], begin);
+		}
+	}
+}
+
+double HaloExchange::seconds() const
+{
+	return elapsed;
+}
+
+namespace {
+
+class P2PHalo : public HaloExchange {
+public:
+	P2PHalo(MPI_Comm comm, int prev, int next, unsigned long length)
+		: HaloExchange(comm, prev, next, length)
+	{
+		MPI_Comm_rank(comm, &rank);
+	}
+
+	void attach(PGM_HOLDER&, PGM_HOLDER&) override
+	{
+	}
+
+	const char *name() const override
+	{
+		return "p2p";
+	}
+
+protected:
+	void exchange_rows(PGM_HOLDER& chunk) override
+	{
+		const auto rows = chunk_rows(chunk, row_length);
+		const int length = int(row_length);
+		MPI_Request sends[2];
+		static const Transfer sent[2] = { Transfer::to_prev, Transfer::to_next };
+		double sends_begin = MPI_Wtime();
+		if (rank) {
+			MPI_Isend(chunk.data() + row_length, length, MPI_UNSIGNED_CHAR, prev_rank, FIRST_ROW_OF_SENDING_RANK, world, &sends[0]);
+			MPI_Isend(chunk.data() + rows * row_length, length, MPI_UNSIGNED_CHAR, next_rank, LAST_ROW_OF_SENDING_RANK, world, &sends[1]);
+		}
+		double begin = MPI_Wtime();
+		MPI_Recv(chunk.data(), length, MPI_UNSIGNED_CHAR, prev_rank, LAST_ROW_OF_SENDING_RANK, world, MPI_STATUS_IGNORE);
+		trace(Transfer::from_prev, begin);
+		begin = MPI_Wtime();
+		MPI_Recv(chunk.data() + (rows + 1) * row_length, length, MPI_UNSIGNED_CHAR, next_rank, FIRST_ROW_OF_SENDING_RANK, world, MPI_STATUS_IGNORE);
+		trace(Transfer::from_next, begin);
+		if (!rank) {
+			sends_begin = MPI_Wtime();
+			MPI_Isend(chunk.data() + row_length, length, MPI_UNSIGNED_CHAR, prev_rank, FIRST_ROW_OF_SENDING_RANK, world, &sends[0]);
+			MPI_Isend(chunk.data() + rows * row_length, length, MPI_UNSIGNED_CHAR, next_rank, LAST_ROW_OF_SENDING_RANK, world, &sends[1]);
+		}
+		wait_all(2, sends, sent, sends_begin);
+	}
+
+private:
+	int rank;
+};
+
+class PersistentHalo : public HaloExchange {
+public:
+	PersistentHalo(MPI_Comm comm, int prev, int next, unsigned long length)
+		: HaloExchange(comm, prev, next, length)
+	{
+	}
+
+	~PersistentHalo()
+	{
+		release();
+	}
+
+	void attach(PGM_HOLDER& chunk, PGM_HOLDER& next_chunk) override
+	{
+		release();
+		for (auto target : { &chunk, &next_chunk }) {
+			if (target->empty()) {
+				continue;
+			}
+			const auto rows = chunk_rows(*target, row_length);
+			const int length = int(row_length);
+			unsigned char *data = target->data();
+			Requests set;
+			set.data = data;
+			MPI_Send_init(data + row_length, length, MPI_UNSIGNED_CHAR, prev_rank, FIRST_ROW_OF_SENDING_RANK, world, &set.requests[0]);
+			MPI_Send_init(data + rows * row_length, length, MPI_UNSIGNED_CHAR, next_rank, LAST_ROW_OF_SENDING_RANK, world, &set.requests[1]);
+			MPI_Recv_init(data, length, MPI_UNSIGNED_CHAR, prev_rank, LAST_ROW_OF_SENDING_RANK, world, &set.requests[2]);
+			MPI_Recv_init(data + (rows + 1) * row_length, length, MPI_UNSIGNED_CHAR, next_rank, FIRST_ROW_OF_SENDING_RANK, world, &set.requests[3]);
+			sets.push_back(set);
+		}
+	}
+
+	const char *name() const override
+	{
+		return "persistent";
+	}
+
+protected:
+	void exchange_rows(PGM_HOLDER& chunk) override
+	{
+		static const Transfer transfers[4] = { Transfer::to_prev, Transfer::to_next, Transfer::from_prev, Transfer::from_next };
+		auto set = std::find_if(sets.begin(), sets.end(), [&chunk](const Requests& s) { return s.data == chunk.data(); });
+		const double begin = MPI_Wtime();
+		MPI_Startall(4, set->requests);
+		wait_all(4, set->requests, transfers, begin);
+	}
+
+private:
+	struct Requests {
+		unsigned char *data;
+		MPI_Request requests[4];
+	};
+
+	void release()
+	{
+		for (auto& set : sets) {
+			for (auto& request : set.requests) {
+				MPI_Request_free(&request);
+			}
+		}
+		sets.clear();
+	}
+
+	std::vector<Requests> sets;
+};
+
+class RmaHalo : public HaloExchange {
+public:
+	RmaHalo(MPI_Comm comm, int prev, int next, unsigned long length)
+		: HaloExchange(comm, prev, next, length), prev_bottom_halo{0}
+	{
+		MPI_Group world_group;
+		MPI_Comm_group(comm, &world_group);
+		const int ranks[2] = { prev, next };
+		MPI_Group_incl(world_group, prev == next ? 1 : 2, ranks, &neighbors);
+		MPI_Group_free(&world_group);
+	}
+
+	~RmaHalo()
+	{
+		release();
+		MPI_Group_free(&neighbors);
+	}
+
+	void attach(PGM_HOLDER& chunk, PGM_HOLDER& next_chunk) override
+	{
+		release();
+		// the halo our first row goes to sits after the rows of the previous rank, which may own more or less rows
+		unsigned long rows = chunk_rows(chunk, row_length), prev_rows;
+		MPI_Sendrecv(&rows, 1, MPI_UNSIGNED_LONG, next_rank, LAST_ROW_OF_SENDING_RANK,
+					&prev_rows, 1, MPI_UNSIGNED_LONG, prev_rank, LAST_ROW_OF_SENDING_RANK, world, MPI_STATUS_IGNORE);
+		prev_bottom_halo = MPI_Aint((prev_rows + 1) * row_length);
+		for (auto target : { &chunk, &next_chunk }) {
+			if (target->empty()) {
+				continue;
+			}
+			Window window;
+			window.data = target->data();
+			MPI_Win_create(target->data(), MPI_Aint(target->size()), 1, MPI_INFO_NULL, world, &window.win);
+			windows.push_back(window);
+		}
+	}
+
+	const char *name() const override
+	{
+		return "rma";
+	}
+
+protected:
+	void exchange_rows(PGM_HOLDER& chunk) override
+	{
+		const auto rows = chunk_rows(chunk, row_length);
+		const int length = int(row_length);
+		auto window = std::find_if(windows.begin(), windows.end(), [&chunk](const Window& w) { return w.data == chunk.data(); });
+		const double begin = MPI_Wtime();
+		MPI_Win_post(neighbors, 0, window->win);
+		MPI_Win_start(neighbors, 0, window->win);
+		MPI_Put(chunk.data() + row_length, length, MPI_UNSIGNED_CHAR, prev_rank, prev_bottom_halo, length, MPI_UNSIGNED_CHAR, window->win);
+		MPI_Put(chunk.data() + rows * row_length, length, MPI_UNSIGNED_CHAR, next_rank, 0, length, MPI_UNSIGNED_CHAR, window->win);
+		// the puts of an epoch complete together, and so do those of the neighbors
+		MPI_Win_complete(window->win);
+		trace(Transfer::to_prev, begin);
+		trace(Transfer::to_next, begin);
+		MPI_Win_wait(window->win);
+		trace(Transfer::from_prev, begin);
+		trace(Transfer::from_next, begin);
+	}
+
+private:
+	struct Window {
+		unsigned char *data;
+		MPI_Win win;
+	};
+
+	void release()
+	{
+		for (auto& window : windows) {
+			MPI_Win_free(&window.win);
+		}
+		windows.clear();
+	}
+
+	MPI_Group neighbors;
+	MPI_Aint prev_bottom_halo;
+	std::vector<Window> windows;
+};
+
+class NeighborHalo : public HaloExchange {
+public:
+	NeighborHalo(MPI_Comm comm, int prev, int next, unsigned long length)
+		: HaloExchange(comm, prev, next, length),
+		counts{ int(length), int(length) }, send_displacements{}, receive_displacements{},
+		types{ MPI_UNSIGNED_CHAR, MPI_UNSIGNED_CHAR }
+	{
+		// block 0 is sent to the previous rank and block 1 to the next; received blocks are matched in the same order
+		const int neighbor_ranks[2] = { prev, next };
+		MPI_Dist_graph_create_adjacent(comm, 2, neighbor_ranks, MPI_UNWEIGHTED, 2, neighbor_ranks, MPI_UNWEIGHTED,
+										MPI_INFO_NULL, 0, &graph);
+	}
+
+	~NeighborHalo()
+	{
+		MPI_Comm_free(&graph);
+	}
+
+	void attach(PGM_HOLDER& chunk, PGM_HOLDER&) override
+	{
+		const auto rows = chunk_rows(chunk, row_length);
+		send_displacements[0] = MPI_Aint(row_length);
+		send_displacements[1] = MPI_Aint(rows * row_length);
+		receive_displacements[0] = 0;
+		receive_displacements[1] = MPI_Aint((rows + 1) * row_length);
+		if (prev_rank == next_rank) {
+			// with two ranks both edges join the same pair, and the first row of the other rank arrives first
+			std::swap(receive_displacements[0], receive_displacements[1]);
+		}
+	}
+
+	const char *name() const override
+	{
+		return "neighbor";
+	}
+
+protected:
+	void exchange_rows(PGM_HOLDER& chunk) override
+	{
+		const double begin = MPI_Wtime();
+		MPI_Neighbor_alltoallw(chunk.data(), counts, send_displacements, types,
+								chunk.data(), counts, receive_displacements, types, graph);
+		// a single collective moves the four rows
+		for (const auto transfer : { Transfer::to_prev, Transfer::to_next, Transfer::from_prev, Transfer::from_next }) {
+			trace(transfer, begin);
+		}
+	}
+
+private:
+	MPI_Comm graph;
+	int counts[2];
+	MPI_Aint send_displacements[2];
+	MPI_Aint receive_displacements[2];
+	MPI_Datatype types[2];
+};
+
+class NodeSharedHalo : public HaloExchange {
+public:
+	NodeSharedHalo(MPI_Comm comm, int prev, int next, unsigned long length)
+		: HaloExchange(comm, prev, next, length), chunks{comm, prev, next}
+	{
+	}
+
+	ChunkMemory *memory() override
+	{
+		return &chunks;
+	}
+
+	void attach(PGM_HOLDER&, PGM_HOLDER&) override
+	{
+		chunks.publish_loaded();
+	}
+
+	void publish() override
+	{
+		chunks.publish_step();
+	}
+
+	const char *name() const override
+	{
+		return "node-shared";
+	}
+
+protected:
+	// halo rows of neighbors on the same node are copied straight out of their chunks, the others travel as messages
+	void exchange_rows(PGM_HOLDER& chunk) override
+	{
+		const auto rows = chunk_rows(chunk, row_length);
+		const int length = int(row_length);
+		MPI_Request sends[2] = { MPI_REQUEST_NULL, MPI_REQUEST_NULL };
+		static const Transfer sent[2] = { Transfer::to_prev, Transfer::to_next };
+		// the wait for the neighbors on the node to publish their rows counts towards the receives
+		const double begin = MPI_Wtime();
+		chunks.wait_for_neighbors();
+		if (!chunks.prev_on_node()) {
+			MPI_Isend(chunk.data() + row_length, length, MPI_UNSIGNED_CHAR, prev_rank, FIRST_ROW_OF_SENDING_RANK, world, &sends[0]);
+		}
+		if (!chunks.next_on_node()) {
+			MPI_Isend(chunk.data() + rows * row_length, length, MPI_UNSIGNED_CHAR, next_rank, LAST_ROW_OF_SENDING_RANK, world, &sends[1]);
+		}
+		if (chunks.prev_on_node()) {
+			const auto [prev_chunk, prev_size] = chunks.prev_chunk(chunk.data());
+			std::copy_n(prev_chunk + prev_size - 2 * row_length, row_length, chunk.data());
+		} else {
+			MPI_Recv(chunk.data(), length, MPI_UNSIGNED_CHAR, prev_rank, LAST_ROW_OF_SENDING_RANK, world, MPI_STATUS_IGNORE);
+		}
+		trace(Transfer::from_prev, begin);
+		if (chunks.next_on_node()) {
+			const auto [next_chunk, next_size] = chunks.next_chunk(chunk.data());
+			std::copy_n(next_chunk + row_length, row_length, chunk.data() + (rows + 1) * row_length);
+		} else {
+			MPI_Recv(chunk.data() + (rows + 1) * row_length, length, MPI_UNSIGNED_CHAR, next_rank, FIRST_ROW_OF_SENDING_RANK, world, MPI_STATUS_IGNORE);
+		}
+		trace(Transfer::from_next, begin);
+		wait_all(2, sends, sent, begin);
+	}
+
+private:
+	NodeSharedChunks chunks;
+};
+
+}
+
+std::unique_ptr<HaloExchange> HaloExchange::create(const std::string& name, MPI_Comm world,
+												int prev_rank, int next_rank, unsigned long row_length)
+{
+	if (name == "p2p") {
+		return std::make_unique<P2PHalo>(world, prev_rank, next_rank, row_length);
+	} else if (name == "persistent") {
+		return std::make_unique<PersistentHalo>(world, prev_rank, next_rank, row_length);
+	} else if (name == "rma") {
+		return std::make_unique<RmaHalo>(world, prev_rank, next_rank, row_length);
+	} else if (name == "neighbor") {
+		return std::make_unique<NeighborHalo>(world, prev_rank, next_rank, row_length);
+	} else if (name == "node-shared") {
+		return std::make_unique<NodeSharedHalo>(world, prev_rank, next_rank, row_length);
+	}
+	return nullptr;
+}
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <JobServer.hpp>
+
+#define JOB_SHUTDOWN	"shutdown"
+#define ACCEPT_BACKOFF_MIN_US	10000U
+#define ACCEPT_BACKOFF_MAX_US	1000000U
+
+namespace mpi = boost::mpi;
+
+JobServer::JobServer(const std::string& path, mpi::communicator comm)
+	: world{comm}, socket_path{path}, listen_fd{-1}, client_fd{-1}, ok{true}
+{
+	if (!world.rank()) {
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		ok = path.size() < sizeof(address.sun_path);
+		if (ok) {
+			std::strcpy(address.sun_path, path.c_str());
+			unlink(path.c_str());
+			listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+			ok = listen_fd >= 0 && bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0
+				&& listen(listen_fd, 16) == 0;
+			if (!ok) {
+				std::perror(path.c_str());
+			}
+		}
+	}
+	mpi::broadcast(world, ok, 0);
+}
+
+JobServer::~JobServer()
+{
+	if (client_fd >= 0) {
+		close(client_fd);
+	}
+	if (listen_fd >= 0) {
+		close(listen_fd);
+		unlink(socket_path.c_str());
+	}
+}
+
+bool JobServer::listening() const
+{
+	return ok;
+}
+
+bool JobServer::read_line(std::string& line)
+{
+	std::size_t end;
+	while ((end = pending.find('\n')) == std::string::npos) {
+		char buffer[4096];
+		const auto received = recv(client_fd, buffer, sizeof(buffer), 0);
+		if (received <= 0) {
+			pending.clear();
+			return false;
+		}
+		pending.append(buffer, std::size_t(received));
+	}
+	line = pending.substr(0, end);
+	pending.erase(0, end + 1);
+	return true;
+}
+
+std::string JobServer::next_job()
+{
+	std::string job;
+	if (!world.rank()) {
+		unsigned backoff_us = ACCEPT_BACKOFF_MIN_US;
+		while (job.empty()) {
+			if (client_fd < 0) {
+				client_fd = accept(listen_fd, nullptr, nullptr);
+				// perror may change errno
+				const int error = client_fd < 0 ? errno : 0;
+				if (client_fd < 0 && error != EINTR && error != ECONNABORTED) {
+					std::perror(socket_path.c_str());
+					if (error == EBADF || error == EINVAL || error == ENOTSOCK || error == EOPNOTSUPP) {
+						// the listening socket itself is broken, nothing more will come in
+						job = JOB_SHUTDOWN;
+						break;
+					}
+					// out of descriptors or memory: give the jobs in flight elsewhere some time to release them
+					usleep(backoff_us);
+					backoff_us = std::min(2 * backoff_us, ACCEPT_BACKOFF_MAX_US);
+				}
+				continue;
+			}
+			if (!read_line(job)) {
+				close(client_fd);
+				client_fd = -1;
+			}
+			job.erase(0, job.find_first_not_of(" \t\r"));
+			job.erase(job.find_last_not_of(" \t\r") + 1);
+		}
+		if (job == JOB_SHUTDOWN) {
+			job.clear();
+		}
+	}
+	mpi::broadcast(world, job, 0);
+	return job;
+}
+
+void JobServer::reply(const std::string& lines)
+{
+	if (world.rank() || client_fd < 0) {
+		return;
+	}
+	for (std::size_t sent = 0; sent < lines.size();) {
+		const auto written = send(client_fd, lines.data() + sent, lines.size() - sent, MSG_NOSIGNAL);
+		if (written <= 0) {
+			// the client went away, its remaining jobs are dropped along with the connection
+			close(client_fd);
+			client_fd = -1;
+			pending.clear();
+			return;
+		}
+		sent += std::size_t(written);
+	}
+}
@@ -0,0 +1,104 @@
+#include <cstdint>
+#include <sstream>
+#include <omp.h>
+#include <HaloExchange.hpp>
+#include <LargerThanLife.hpp>
+
+bool LargerThanLife::parse_interval(const std::string& text, unsigned long& min, unsigned long& max)
+{
+	std::istringstream fields{text};
+	char comma;
+	fields >> min >> comma >> max;
+	return fields && fields.peek() == EOF && comma == ',' && min <= max;
+}
+
+LargerThanLife::LargerThanLife(const Rule& automaton_rule, unsigned long length, MPI_Comm comm, int prev, int next)
+	: rule{automaton_rule}, row_length{length}, stride{PgmUtils::row_stride(length)}, world{comm}, prev_rank{prev},
+	next_rank{next}, above(rule.radius * stride, 0), below(rule.radius * stride, 0), elapsed{0}
+{
+}
+
+void LargerThanLife::exchange(const PGM_HOLDER& chunk)
+{
+	int ranks;
+	MPI_Comm_size(world, &ranks);
+	if (ranks == 1) {
+		return;
+	}
+	const double start = MPI_Wtime();
+	const auto rows = chunk.size() / stride - 2;
+	const int length = int(rule.radius * stride);
+	MPI_Request requests[4];
+	MPI_Irecv(above.data(), length, MPI_UNSIGNED_CHAR, prev_rank, LAST_ROW_OF_SENDING_RANK, world, &requests[0]);
+	MPI_Irecv(below.data(), length, MPI_UNSIGNED_CHAR, next_rank, FIRST_ROW_OF_SENDING_RANK, world, &requests[1]);
+	MPI_Isend(chunk.data() + stride, length, MPI_UNSIGNED_CHAR, prev_rank, FIRST_ROW_OF_SENDING_RANK, world, &requests[2]);
+	MPI_Isend(chunk.data() + (rows + 1 - rule.radius) * stride, length, MPI_UNSIGNED_CHAR, next_rank,
+			LAST_ROW_OF_SENDING_RANK, world, &requests[3]);
+	MPI_Waitall(4, requests, MPI_STATUSES_IGNORE);
+	elapsed += MPI_Wtime() - start;
+}
+
+double LargerThanLife::seconds() const
+{
+	return elapsed;
+}
+
+void LargerThanLife::evolve(const PGM_HOLDER& chunk, PGM_HOLDER& next)
+{
+	exchange(chunk);
+	const long rows = long(chunk.size() / stride - 2);
+	const long radius = long(rule.radius);
+	const auto width = row_length;
+	// cells of band row r, r in [-radius, rows + radius)
+	const auto cells = [&](long r) -> const unsigned char* {
+		if (r < 0) {
+			return above.data() + (r + radius) * stride + 1;
+		}
+		if (r >= rows) {
+			return below.data() + (r - rows) * stride + 1;
+		}
+		return chunk.data() + (r + 1) * stride + 1;
+	};
+	const unsigned int nthreads = omp_get_max_threads();
+#pragma omp parallel for schedule(static)
+	for (unsigned int t = 0; t < nthreads; t++) {
+		const auto [first, last] = PgmUtils::thread_slice(rows, t, nthreads);
+		std::vector<std::uint16_t> columns(width, 0);
+		std::vector<std::uint32_t> prefix(width + 2 * radius + 1, 0);
+		for (long r = long(first) - radius; r < long(first) + radius; r++) {
+			const unsigned char *entering = cells(r);
+			for (unsigned long c = 0; c < width; c++) {
+				columns[c] += entering[c] & 1;
+			}
+		}
+		for (long r = long(first); r < long(last); r++) {
+			const unsigned char *entering = cells(r + radius);
+			for (unsigned long c = 0; c < width; c++) {
+				columns[c] += entering[c] & 1;
+			}
+			// prefix[j + 1] sums the column sums of the cells from j - radius to j, wrapping around
+			for (long j = 0; j < radius; j++) {
+				prefix[j + 1] = prefix[j] + columns[width - radius + j];
+			}
+			for (unsigned long c = 0; c < width; c++) {
+				prefix[radius + c + 1] = prefix[radius + c] + columns[c];
+			}
+			for (long j = 0; j < radius; j++) {
+				prefix[radius + width + j + 1] = prefix[radius + width + j] + columns[j];
+			}
+			const unsigned char *current = cells(r);
+			unsigned char *written = next.data() + (r + 1) * stride + 1;
+			for (unsigned long c = 0; c < width; c++) {
+				const bool alive = current[c] & 1;
+				const auto count = prefix[c + 2 * radius + 1] - prefix[c] - alive;
+				written[c] = (alive ? count >= rule.survival_min && count <= rule.survival_max
+					: count >= rule.birth_min && count <= rule.birth_max) ? 0xFF : 0x00;
+			}
+			PgmUtils::refresh_ghost_cells(written - 1, width);
+			const unsigned char *leaving = cells(r - radius);
+			for (unsigned long c = 0; c < width; c++) {
+				columns[c] -= leaving[c] & 1;
+			}
+		}
+	}
+}
@@ -0,0 +1,41 @@
+#include <algorithm>
+#include <LookupTable.hpp>
+#include <PgmUtils.hpp>
+
+std::array<unsigned char, LOOKUP_TABLE_SIZE> LookupTable::build(bool (*rule)(bool, unsigned int))
+{
+	std::array<unsigned char, LOOKUP_TABLE_SIZE> table;
+	for (unsigned int index = 0; index < LOOKUP_TABLE_SIZE; index++) {
+		const auto cell = [index](unsigned int row, unsigned int column) { return (index >> (4 * row + column)) & 1; };
+		unsigned char block = 0;
+		for (unsigned int row = 1; row <= 2; row++) {
+			for (unsigned int column = 1; column <= 2; column++) {
+				unsigned int neighbors = 0;
+				for (unsigned int r = row - 1; r <= row + 1; r++) {
+					for (unsigned int c = column - 1; c <= column + 1; c++) {
+						neighbors += cell(r, c);
+					}
+				}
+				neighbors -= cell(row, column);
+				block |= rule(cell(row, column), neighbors) << (2 * (row - 1) + column - 1);
+			}
+		}
+		table[index] = block;
+	}
+	return table;
+}
+
+void LookupTable::pack_row(const unsigned char *cells, unsigned long length, unsigned char *bits)
+{
+	const auto bytes = length / 8;
+	// cells are either 0 or 255: the multiplication gathers the lowest bit of byte k of the word into bit k of its top byte
+	for (auto i = 0UL; i < bytes; i++) {
+		std::uint64_t word;
+		std::memcpy(&word, cells + 8 * i, sizeof(word));
+		bits[i] = static_cast<unsigned char>(((word & 0x0101010101010101ULL) * 0x0102040810204080ULL) >> 56);
+	}
+	std::fill(bits + bytes, bits + packed_length(length), 0);
+	for (auto j = bytes * 8; j < length; j++) {
+		bits[bytes] |= (cells[j] == PGM_MAX_VALUE) << (j % 8);
+	}
+}
@@ -0,0 +1,84 @@
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/mman.h>
+#include <MappedChunks.hpp>
+
+#define DEFAULT_HUGE_PAGE_SIZE	(2UL << 20)
+
+// default size of the hugetlbfs pages, which is also the size of transparent huge pages on x86-64
+static std::size_t read_huge_page_size()
+{
+	std::ifstream meminfo{"/proc/meminfo"};
+	for (std::string line; std::getline(meminfo, line);) {
+		std::istringstream fields{line};
+		std::string key;
+		std::size_t kb;
+		if (fields >> key >> kb && key == "Hugepagesize:") {
+			return kb << 10;
+		}
+	}
+	return DEFAULT_HUGE_PAGE_SIZE;
+}
+
+MappedChunks::MappedChunks(bool use_hugetlb)
+	: hugetlb{use_hugetlb}, huge_page_size{read_huge_page_size()}, hugetlb_failures{0}
+{
+}
+
+std::size_t MappedChunks::mapping_length(std::size_t bytes) const
+{
+	return (bytes + huge_page_size - 1) / huge_page_size * huge_page_size;
+}
+
+void *MappedChunks::allocate(std::size_t bytes)
+{
+	const auto length = mapping_length(bytes);
+	if (hugetlb) {
+		void *ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (ptr != MAP_FAILED) {
+			return ptr;
+		}
+		hugetlb_failures++;
+	}
+	// one huge page more than needed, so that the mapping can be trimmed to start on a huge page boundary
+	void *raw = mmap(nullptr, length + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (raw == MAP_FAILED) {
+		return nullptr;
+	}
+	const auto address = reinterpret_cast<std::uintptr_t>(raw);
+	const auto aligned = (address + huge_page_size - 1) & ~std::uintptr_t(huge_page_size - 1);
+	const auto head = aligned - address;
+	if (head) {
+		munmap(raw, head);
+	}
+	munmap(reinterpret_cast<void*>(aligned + length), huge_page_size - head);
+	madvise(reinterpret_cast<void*>(aligned), length, MADV_HUGEPAGE);
+	return reinterpret_cast<void*>(aligned);
+}
+
+void MappedChunks::deallocate(void *ptr, std::size_t bytes)
+{
+	munmap(ptr, mapping_length(bytes));
+}
+
+unsigned long MappedChunks::fallbacks() const
+{
+	return hugetlb_failures;
+}
+
+unsigned long MappedChunks::resident_huge_kb()
+{
+	std::ifstream rollup{"/proc/self/smaps_rollup"};
+	unsigned long total = 0;
+	for (std::string line; std::getline(rollup, line);) {
+		std::istringstream fields{line};
+		std::string key;
+		unsigned long kb;
+		if (fields >> key >> kb && (key == "AnonHugePages:" || key == "Shared_Hugetlb:" || key == "Private_Hugetlb:")) {
+			total += kb;
+		}
+	}
+	return total;
+}
@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+#include <MetricsFile.hpp>
+
+#define SAMPLE_FIELDS	5 // step, compute and communication seconds, population, bytes written
+
+MetricsFile::MetricsFile(const std::string& file, double interval_seconds, unsigned int total_steps, unsigned long length, MPI_Comm comm)
+	: filename{file}, interval{interval_seconds}, steps{total_steps}, row_length{length}, world{comm}, pending{false},
+	round_step{0}, next_round_step{1}, stride{1}, sample(SAMPLE_FIELDS, 0.0), previous_round_step{0}
+{
+	MPI_Comm_rank(world, &rank);
+	MPI_Comm_size(world, &ranks);
+	gathered.resize(rank ? 0 : std::size_t(ranks) * SAMPLE_FIELDS);
+	start_time = round_time = previous_round_time = MPI_Wtime();
+}
+
+MetricsFile::~MetricsFile()
+{
+	if (pending) {
+		MPI_Waitall(2, requests, MPI_STATUSES_IGNORE);
+	}
+}
+
+static unsigned long count_population(const PGM_HOLDER& chunk, unsigned long row_length)
+{
+	const auto stride = PgmUtils::row_stride(row_length);
+	const auto rows = chunk.size() / stride - 2;
+	unsigned long population = 0;
+#pragma omp parallel for schedule(static) reduction(+:population)
+	for (unsigned long row = 1; row <= rows; row++) {
+		const unsigned char *cells = chunk.data() + row * stride + 1;
+		for (unsigned long c = 0; c < row_length; c++) {
+			population += cells[c] & 1;
+		}
+	}
+	return population;
+}
+
+void MetricsFile::start_round(unsigned int step, const PGM_HOLDER& chunk, const Counters& counters)
+{
+	sample = { double(step), counters.compute_seconds, counters.communication_seconds,
+		double(count_population(chunk, row_length)), counters.bytes_written };
+	if (!rank) {
+		previous_round_step = round_step;
+		previous_round_time = round_time;
+		round_time = MPI_Wtime();
+		const double rate = double(step - previous_round_step) / std::max(round_time - previous_round_time, 1e-9);
+		stride = unsigned(std::max(1.0, std::round(interval * rate)));
+	}
+	round_step = step;
+	MPI_Igather(sample.data(), SAMPLE_FIELDS, MPI_DOUBLE, gathered.data(), SAMPLE_FIELDS, MPI_DOUBLE, 0, world, &requests[0]);
+	MPI_Ibcast(&stride, 1, MPI_UNSIGNED, 0, world, &requests[1]);
+	pending = true;
+}
+
+void MetricsFile::complete_round()
+{
+	MPI_Waitall(2, requests, MPI_STATUSES_IGNORE);
+	pending = false;
+	next_round_step = round_step + stride;
+	if (!rank) {
+		write();
+	}
+}
+
+void MetricsFile::observe(unsigned int step, const PGM_HOLDER& chunk, const Counters& counters)
+{
+	if (pending) {
+		complete_round();
+	}
+	if (step >= next_round_step) {
+		start_round(step, chunk, counters);
+	}
+}
+
+void MetricsFile::finish(unsigned int step, const PGM_HOLDER& chunk, const Counters& counters)
+{
+	if (pending) {
+		complete_round();
+	}
+	if (step != round_step) {
+		start_round(step, chunk, counters);
+		complete_round();
+	}
+}
+
+void MetricsFile::write() const
+{
+	const auto field = [this](int r, int k) { return gathered[std::size_t(r) * SAMPLE_FIELDS + k]; };
+	double population = 0, bytes_written = 0, compute_max = 0, compute_sum = 0, communication_max = 0, communication_sum = 0;
+	for (int r = 0; r < ranks; r++) {
+		compute_max = std::max(compute_max, field(r, 1));
+		compute_sum += field(r, 1);
+		communication_max = std::max(communication_max, field(r, 2));
+		communication_sum += field(r, 2);
+		population += field(r, 3);
+		bytes_written += field(r, 4);
+	}
+	const double rate = round_step > previous_round_step ?
+		double(round_step - previous_round_step) / std::max(round_time - previous_round_time, 1e-9) : 0.0;
+	// relative excess of the slowest rank over the average
+	const auto imbalance = [this](double max, double sum) { return sum > 0 ? max * ranks / sum - 1 : 0.0; };
+
+	const auto temporary = filename + ".tmp";
+	{
+		std::ofstream out{temporary, std::ios_base::trunc};
+		const auto metric = [&out](const char *name, const char *type, const char *help) {
+			out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+		};
+		metric("gol_step", "gauge", "Last step reached by all ranks.");
+		out << "gol_step " << round_step << "\n";
+		metric("gol_steps", "gauge", "Steps of the run.");
+		out << "gol_steps " << steps << "\n";
+		metric("gol_steps_per_second", "gauge", "Steps per second since the previous publication.");
+		out << "gol_steps_per_second " << rate << "\n";
+		metric("gol_eta_seconds", "gauge", "Estimated seconds until the last step, at the current rate.");
+		out << "gol_eta_seconds " << (rate > 0 ? double(steps - std::min(round_step, steps)) / rate : 0.0) << "\n";
+		metric("gol_elapsed_seconds", "gauge", "Seconds since the start of the run.");
+		out << "gol_elapsed_seconds " << round_time - start_time << "\n";
+		metric("gol_population", "gauge", "Live cells of the grid.");
+		out << "gol_population " << std::uint64_t(population) << "\n";
+		metric("gol_snapshot_bytes_total", "counter", "Bytes of snapshot cells written, before compression for tiled snapshots.");
+		out << "gol_snapshot_bytes_total " << std::uint64_t(bytes_written) << "\n";
+		metric("gol_compute_seconds_total", "counter", "Seconds spent computing generations, per rank.");
+		for (int r = 0; r < ranks; r++) {
+			out << "gol_compute_seconds_total{rank=\"" << r << "\"} " << field(r, 1) << "\n";
+		}
+		metric("gol_communication_seconds_total", "counter", "Seconds spent exchanging halos, per rank.");
+		for (int r = 0; r < ranks; r++) {
+			out << "gol_communication_seconds_total{rank=\"" << r << "\"} " << field(r, 2) << "\n";
+		}
+		metric("gol_compute_imbalance", "gauge", "Excess of the slowest rank over the average compute seconds.");
+		out << "gol_compute_imbalance " << imbalance(compute_max, compute_sum) << "\n";
+		metric("gol_communication_imbalance", "gauge", "Excess of the slowest rank over the average communication seconds.");
+		out << "gol_communication_imbalance " << imbalance(communication_max, communication_sum) << "\n";
+	}
+	std::rename(temporary.c_str(), filename.c_str());
+}
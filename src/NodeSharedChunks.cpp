@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <cstdint>
+#include <tuple>
+#include <sched.h>
+#include <NodeSharedChunks.hpp>
+
+static inline unsigned char *align_up(void *ptr)
+{
+	const auto address = reinterpret_cast<std::uintptr_t>(ptr);
+	return reinterpret_cast<unsigned char*>((address + CHUNK_ALIGNMENT - 1) & ~std::uintptr_t(CHUNK_ALIGNMENT - 1));
+}
+
+/*
+ * Every segment starts, once aligned, with a cache line holding the size requested by its owner
+ * (MPI_Win_shared_query reports the size rounded up to whole pages), followed by the payload.
+ */
+static std::pair<unsigned char*, std::size_t> query_segment(MPI_Win win, int owner)
+{
+	if (owner == MPI_UNDEFINED) {
+		return { nullptr, 0 };
+	}
+	MPI_Aint size;
+	int disp_unit;
+	void *base;
+	MPI_Win_shared_query(win, owner, &size, &disp_unit, &base);
+	unsigned char *header = align_up(base);
+	return { header + CHUNK_ALIGNMENT, *reinterpret_cast<std::size_t*>(header) };
+}
+
+// collective over node_comm; returns the payload of the calling rank
+static unsigned char *allocate_window(MPI_Comm node_comm, std::size_t bytes, MPI_Win *win)
+{
+	MPI_Info info;
+	MPI_Info_create(&info);
+	MPI_Info_set(info, "alloc_shared_noncontig", "true");
+	void *base;
+	MPI_Win_allocate_shared(MPI_Aint(bytes + 2 * CHUNK_ALIGNMENT), 1, info, node_comm, &base, win);
+	MPI_Info_free(&info);
+	MPI_Win_lock_all(MPI_MODE_NOCHECK, *win);
+	unsigned char *header = align_up(base);
+	*reinterpret_cast<std::size_t*>(header) = bytes;
+	MPI_Win_sync(*win);
+	MPI_Barrier(node_comm);
+	return header + CHUNK_ALIGNMENT;
+}
+
+NodeSharedChunks::NodeSharedChunks(MPI_Comm world, int prev_rank, int next_rank)
+	: generation{0}
+{
+	MPI_Comm_split_type(world, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node_comm);
+	MPI_Group world_group, node_group;
+	MPI_Comm_group(world, &world_group);
+	MPI_Comm_group(node_comm, &node_group);
+	int world_ranks[2] = { prev_rank, next_rank };
+	int node_ranks[2];
+	MPI_Group_translate_ranks(world_group, 2, world_ranks, node_group, node_ranks);
+	MPI_Group_free(&world_group);
+	MPI_Group_free(&node_group);
+	node_prev = node_ranks[0];
+	node_next = node_ranks[1];
+
+	own_flag = reinterpret_cast<std::uint64_t*>(allocate_window(node_comm, sizeof(std::uint64_t), &flags_win));
+	__atomic_store_n(own_flag, 0, __ATOMIC_RELEASE);
+	prev_flag = reinterpret_cast<std::uint64_t*>(query_segment(flags_win, node_prev).first);
+	next_flag = reinterpret_cast<std::uint64_t*>(query_segment(flags_win, node_next).first);
+	MPI_Win_sync(flags_win);
+	MPI_Barrier(node_comm);
+}
+
+NodeSharedChunks::~NodeSharedChunks()
+{
+	MPI_Win_unlock_all(flags_win);
+	MPI_Win_free(&flags_win);
+	MPI_Comm_free(&node_comm);
+}
+
+void *NodeSharedChunks::allocate(std::size_t bytes)
+{
+	Window window;
+	window.base = allocate_window(node_comm, bytes, &window.win);
+	std::tie(window.prev_base, window.prev_bytes) = query_segment(window.win, node_prev);
+	std::tie(window.next_base, window.next_bytes) = query_segment(window.win, node_next);
+	windows.push_back(window);
+	return window.base;
+}
+
+void NodeSharedChunks::deallocate(void *ptr, std::size_t)
+{
+	auto window = std::find_if(windows.begin(), windows.end(), [ptr](const Window& w) { return w.base == ptr; });
+	MPI_Win_unlock_all(window->win);
+	MPI_Win_free(&window->win);
+	windows.erase(window);
+}
+
+bool NodeSharedChunks::prev_on_node() const
+{
+	return node_prev != MPI_UNDEFINED;
+}
+
+bool NodeSharedChunks::next_on_node() const
+{
+	return node_next != MPI_UNDEFINED;
+}
+
+const NodeSharedChunks::Window& NodeSharedChunks::window_of(const unsigned char *own_chunk) const
+{
+	return *std::find_if(windows.begin(), windows.end(), [own_chunk](const Window& w) { return w.base == own_chunk; });
+}
+
+std::pair<const unsigned char*, std::size_t> NodeSharedChunks::prev_chunk(const unsigned char *own_chunk) const
+{
+	const auto& window = window_of(own_chunk);
+	return { window.prev_base, window.prev_bytes };
+}
+
+std::pair<const unsigned char*, std::size_t> NodeSharedChunks::next_chunk(const unsigned char *own_chunk) const
+{
+	const auto& window = window_of(own_chunk);
+	return { window.next_base, window.next_bytes };
+}
+
+void NodeSharedChunks::wait_for(const std::uint64_t *flag)
+{
+	while (__atomic_load_n(flag, __ATOMIC_ACQUIRE) < generation + 1) {
+		MPI_Win_sync(flags_win);
+		sched_yield();
+	}
+}
+
+void NodeSharedChunks::publish_loaded()
+{
+	publish();
+	MPI_Barrier(node_comm);
+}
+
+void NodeSharedChunks::publish()
+{
+	__atomic_store_n(own_flag, generation + 1, __ATOMIC_RELEASE);
+	MPI_Win_sync(flags_win);
+}
+
+void NodeSharedChunks::wait_for_neighbors()
+{
+	if (prev_flag) {
+		wait_for(prev_flag);
+	}
+	if (next_flag) {
+		wait_for(next_flag);
+	}
+}
+
+void NodeSharedChunks::publish_step()
+{
+	generation++;
+	publish();
+}
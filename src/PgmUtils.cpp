@@ -1,6 +1,10 @@
+#include <cstring>
 #include <limits>
 #include <PgmUtils.hpp>
 #include <iostream>
+#include <omp.h>
+
+#define FIRST_TOUCH_PAGE	4096UL
 
 void PgmUtils::write_header(const std::string& filename, const SIZE_HOLDER& dimensions)
 {
@@ -8,40 +12,94 @@ void PgmUtils::write_header(const std::string& filename, const SIZE_HOLDER& dime
 	outstream << "P5 " << dimensions.first << " " << dimensions.second << " " << PGM_MAX_VALUE << std::endl;
 }
 
+// the cells of the rows of a chunk, skipping halo rows, ghost cells and padding
+static MPI_Datatype chunk_cells_type(const PGM_HOLDER& chunk, const ulong row_length)
+{
+	const auto stride = PgmUtils::row_stride(row_length);
+	MPI_Datatype cells;
+	MPI_Type_vector(int(chunk.size() / stride - 2), int(row_length), int(stride), MPI_UNSIGNED_CHAR, &cells);
+	MPI_Type_commit(&cells);
+	return cells;
+}
+
 void PgmUtils::write_chunk_to_file(const std::string& filename, const PGM_HOLDER& chunk,
-									const std::streampos start_offset, const ulong leading_halo_length,
+									const std::streampos start_offset, const ulong row_length,
 									MPI_Comm comm)
 {
 	MPI_File file;
 	MPI_File_open(comm, filename.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
-	std::size_t size = chunk.size() - 2 * leading_halo_length;
+	MPI_Datatype cells = chunk_cells_type(chunk, row_length);
 	MPI_Offset offset = static_cast<MPI_Offset>(start_offset);
-	MPI_File_write_at_all(file, offset, chunk.data() + leading_halo_length, size, MPI_CHAR, MPI_STATUS_IGNORE);
+	MPI_File_write_at_all(file, offset, chunk.data() + row_stride(row_length) + 1, 1, cells, MPI_STATUS_IGNORE);
+	MPI_Type_free(&cells);
 	MPI_File_close(&file);
 }
 
-PGM_HOLDER PgmUtils::read_chunk_from_file(const std::string& filename, const ulong chunk_length,
-									const std::streampos start_offset, const ulong leading_halo_length,
-									MPI_Comm comm)
+void PgmUtils::read_chunk_from_file(const std::string& filename, PGM_HOLDER& chunk, const ulong row_length,
+									const std::streampos start_offset, MPI_Comm comm)
 {
 	MPI_File file;
 	MPI_File_open(comm, filename.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file);
-	PGM_HOLDER chunk(chunk_length + 2 * leading_halo_length);
+	MPI_Datatype cells = chunk_cells_type(chunk, row_length);
 	MPI_Offset offset = static_cast<MPI_Offset>(start_offset);
-	MPI_File_read_at_all(file, offset, chunk.data() + leading_halo_length, chunk_length, MPI_CHAR, MPI_STATUS_IGNORE);
+	const auto stride = row_stride(row_length);
+	MPI_File_read_at_all(file, offset, chunk.data() + stride + 1, 1, cells, MPI_STATUS_IGNORE);
+	MPI_Type_free(&cells);
 	MPI_File_close(&file);
+	for (auto row = 1UL; row < chunk.size() / stride - 1; row++) {
+		refresh_ghost_cells(chunk.data() + row * stride, row_length);
+	}
+}
+
+PGM_HOLDER PgmUtils::read_chunk_from_file(const std::string& filename, const ulong rows, const ulong row_length,
+									const std::streampos start_offset, MPI_Comm comm, ChunkMemory *memory)
+{
+	PGM_HOLDER chunk = allocate_chunk(rows, row_length, memory);
+	read_chunk_from_file(filename, chunk, row_length, start_offset, comm);
+	return chunk;
+}
+
+PGM_HOLDER PgmUtils::generate_random_chunk(const ulong rows, const ulong row_length, std::mt19937_64& generator)
+{
+	PGM_HOLDER chunk = allocate_chunk(rows, row_length);
+	const auto stride = row_stride(row_length);
+	for (auto row = 1UL; row <= rows; row++) {
+		unsigned char *cells = chunk.data() + row * stride;
+		for (auto i = 1UL; i <= row_length; i++) {
+			cells[i] = random_cell(generator) ? 0xFF : 0x00;
+		}
+		refresh_ghost_cells(cells, row_length);
+	}
 	return chunk;
 }
 
-PGM_HOLDER PgmUtils::generate_random_chunk(unsigned long size)
+PGM_HOLDER PgmUtils::allocate_chunk(const ulong rows, const ulong row_length, ChunkMemory *memory, const bool zeroed_cells)
 {
-	PGM_HOLDER chunk(size);
-	std::random_device rd;
-	std::mt19937 generator(rd());
-	std::uniform_int_distribution<int> distribution(0, 1);
-	for (auto i = 0UL; i < size; i++) {
-		int value = distribution(generator);
-		chunk[i] = (value == 0) ? 0x00 : 0xFF;
+	const auto stride = row_stride(row_length);
+	PGM_HOLDER chunk((rows + 2) * stride, chunk_allocator<unsigned char>{memory});
+	const unsigned int nthreads = omp_get_max_threads();
+#pragma omp parallel for schedule(static)
+	for (unsigned int t = 0; t < nthreads; t++) {
+		const auto [first, last] = thread_slice(rows, t, nthreads);
+		if (zeroed_cells) {
+			std::memset(chunk.data() + (first + 1) * stride, 0, (last - first) * stride);
+		} else {
+			for (auto row = first + 1; row <= last; row++) {
+				unsigned char *cells = chunk.data() + row * stride;
+				// one byte per page, so that the pages of the cells are still first touched by this thread
+				for (auto c = 1UL; c <= row_length; c += FIRST_TOUCH_PAGE) {
+					cells[c] = 0;
+				}
+				cells[0] = 0;
+				std::memset(cells + row_length + 1, 0, stride - row_length - 1);
+			}
+		}
+		if (t == 0) {
+			std::memset(chunk.data(), 0, stride);
+		}
+		if (t == nthreads - 1) {
+			std::memset(chunk.data() + (rows + 1) * stride, 0, stride);
+		}
 	}
 	return chunk;
 }
@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <RegionSnapshots.hpp>
+
+bool RegionSnapshots::parse(const std::string& text, unsigned long grid_size, Region& region)
+{
+	// >> would wrap negative numbers around into huge unsigned ones
+	if (text.find('-') != std::string::npos) {
+		return false;
+	}
+	std::istringstream fields{text};
+	char c1, c2, c3, c4;
+	fields >> region.x >> c1 >> region.y >> c2 >> region.width >> c3 >> region.height >> c4 >> region.period;
+	return fields && fields.peek() == EOF && c1 == ',' && c2 == ',' && c3 == ',' && c4 == ','
+		&& region.width && region.height && region.period
+		&& region.x < grid_size && region.width <= grid_size - region.x
+		&& region.y < grid_size && region.height <= grid_size - region.y;
+}
+
+RegionSnapshots::RegionSnapshots(const std::vector<Region>& snapshot_regions, unsigned long size)
+	: regions{snapshot_regions}, grid_size{size}, band_first_row{0}, band_rows{0}
+{
+}
+
+RegionSnapshots::~RegionSnapshots()
+{
+	release();
+}
+
+void RegionSnapshots::release()
+{
+	for (auto& comm : comms) {
+		if (comm != MPI_COMM_NULL) {
+			MPI_Comm_free(&comm);
+		}
+	}
+	comms.clear();
+}
+
+void RegionSnapshots::attach(unsigned long first_row, unsigned long rows, MPI_Comm world)
+{
+	release();
+	band_first_row = first_row;
+	band_rows = rows;
+	int rank;
+	MPI_Comm_rank(world, &rank);
+	for (const auto& region : regions) {
+		const bool intersects = first_row < region.y + region.height && region.y < first_row + rows;
+		MPI_Comm comm;
+		MPI_Comm_split(world, intersects ? 0 : MPI_UNDEFINED, rank, &comm);
+		comms.push_back(comm);
+	}
+}
+
+bool RegionSnapshots::due(unsigned int step) const
+{
+	return std::any_of(regions.begin(), regions.end(), [step](const Region& region) { return step % region.period == 0; });
+}
+
+void RegionSnapshots::save(const PGM_HOLDER& chunk, unsigned int step) const
+{
+	const auto stride = PgmUtils::row_stride(grid_size);
+	for (std::size_t k = 0; k < regions.size(); k++) {
+		const auto& region = regions[k];
+		if (step % region.period || comms[k] == MPI_COMM_NULL) {
+			continue;
+		}
+		std::ostringstream name, header;
+		name << "region" << k << "_" << std::setw(5) << std::setfill('0') << step;
+		header << "P5 " << region.width << " " << region.height << " " << PGM_MAX_VALUE << "\n";
+		const auto header_length = MPI_Offset(header.str().size());
+
+		// rows [first, end) of the region held by this rank
+		const auto first = std::max(region.y, band_first_row);
+		const auto end = std::min(region.y + region.height, band_first_row + band_rows);
+		const int sizes[2] = { int(region.height), int(region.width) };
+		const int subsizes[2] = { int(end - first), int(region.width) };
+		const int starts[2] = { int(first - region.y), 0 };
+		MPI_Datatype file_rows, chunk_rows;
+		MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, MPI_UNSIGNED_CHAR, &file_rows);
+		MPI_Type_commit(&file_rows);
+		MPI_Type_vector(subsizes[0], subsizes[1], int(stride), MPI_UNSIGNED_CHAR, &chunk_rows);
+		MPI_Type_commit(&chunk_rows);
+
+		MPI_File file;
+		MPI_File_open(comms[k], name.str().c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+		MPI_File_set_size(file, header_length + MPI_Offset(region.width * region.height));
+		int region_rank;
+		MPI_Comm_rank(comms[k], &region_rank);
+		if (!region_rank) {
+			MPI_File_write_at(file, 0, header.str().data(), int(header_length), MPI_CHAR, MPI_STATUS_IGNORE);
+		}
+		MPI_File_set_view(file, header_length, MPI_UNSIGNED_CHAR, file_rows, "native", MPI_INFO_NULL);
+		const unsigned char *cells = chunk.data() + (first - band_first_row + 1) * stride + 1 + region.x;
+		MPI_File_write_all(file, cells, 1, chunk_rows, MPI_STATUS_IGNORE);
+		MPI_File_close(&file);
+		MPI_Type_free(&file_rows);
+		MPI_Type_free(&chunk_rows);
+	}
+}
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <RlePattern.hpp>
+
+bool RlePattern::load(const std::string& placement)
+{
+	auto path = placement;
+	x = y = 0;
+	const auto at = placement.rfind('@');
+	if (at != std::string::npos) {
+		path = placement.substr(0, at);
+		char comma;
+		std::istringstream offsets{placement.substr(at + 1)};
+		if (!(offsets >> x >> comma >> y) || comma != ',' || !offsets.eof()) {
+			return false;
+		}
+	}
+	std::ifstream infile{path};
+	std::string line;
+	while (std::getline(infile, line) && (line.empty() || line[0] == '#')) {
+	}
+	// "x = 3, y = 3, rule = B3/S23"
+	line.erase(std::remove_if(line.begin(), line.end(), [](unsigned char c) { return std::isspace(c); }), line.end());
+	if (std::sscanf(line.c_str(), "x=%lu,y=%lu", &columns, &rows) != 2) {
+		return false;
+	}
+	body.clear();
+	while (std::getline(infile, line)) {
+		body += line;
+		if (line.find('!') != std::string::npos) {
+			break;
+		}
+	}
+	return true;
+}
+
+unsigned long RlePattern::width() const
+{
+	return columns;
+}
+
+unsigned long RlePattern::height() const
+{
+	return rows;
+}
+
+void RlePattern::place(PGM_HOLDER& chunk, unsigned long first_row, unsigned long size) const
+{
+	const auto stride = PgmUtils::row_stride(size);
+	const auto band_rows = chunk.size() / stride - 2;
+	// the cells of pattern row r, nullptr outside the band
+	const auto cells_of = [&](unsigned long r) -> unsigned char* {
+		const auto row = (y + r) % size;
+		return row >= first_row && row < first_row + band_rows ? chunk.data() + (row - first_row + 1) * stride + 1 : nullptr;
+	};
+	unsigned long r = 0, c = 0, count = 0;
+	unsigned char *cells = cells_of(0);
+	for (const char token : body) {
+		if (std::isdigit(static_cast<unsigned char>(token))) {
+			count = count * 10 + static_cast<unsigned long>(token - '0');
+			continue;
+		}
+		const auto run = std::max(count, 1UL);
+		count = 0;
+		if (token == '!') {
+			break;
+		} else if (token == '$') {
+			if (cells) {
+				PgmUtils::refresh_ghost_cells(cells - 1, size);
+			}
+			r += run;
+			c = 0;
+			if (r >= rows) {
+				return;
+			}
+			cells = cells_of(r);
+		} else if (std::isalpha(static_cast<unsigned char>(token))) {
+			if (cells && token != 'b') {
+				for (auto k = c; k < std::min(c + run, columns); k++) {
+					cells[(x + k) % size] = PGM_MAX_VALUE;
+				}
+			}
+			c += run;
+		} else if (token == '.') {
+			c += run;
+		}
+	}
+	if (cells) {
+		PgmUtils::refresh_ghost_cells(cells - 1, size);
+	}
+}
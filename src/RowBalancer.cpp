@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <RowBalancer.hpp>
+#include <Trace.hpp>
+
+#define MIGRATED_ROWS	3
+// below this relative excess of the slowest rank, the differences are taken for noise whatever the tolerance
+#define MIN_IMBALANCE	0.02
+
+namespace mpi = boost::mpi;
+
+RowBalancer::RowBalancer(unsigned int rebalance_period, double imbalance_tolerance)
+	: period{rebalance_period}, tolerance{std::max(imbalance_tolerance, MIN_IMBALANCE)}, accumulated{0}, migration_seconds{0}
+{
+}
+
+void RowBalancer::record(double compute_seconds)
+{
+	accumulated += compute_seconds;
+}
+
+// boundaries[r] is the first row of rank r, boundaries[ranks] the number of rows of the grid
+static std::vector<unsigned long> balanced_boundaries(const std::vector<unsigned long>& rows, const std::vector<double>& seconds)
+{
+	const auto ranks = rows.size();
+	std::vector<unsigned long> boundaries(ranks + 1, 0);
+	std::partial_sum(rows.begin(), rows.end(), boundaries.begin() + 1);
+	std::vector<unsigned long> balanced = boundaries;
+	const double total = std::accumulate(seconds.begin(), seconds.end(), 0.0);
+	for (std::size_t k = 1; k < ranks; k++) {
+		// row at which the cumulative cost reaches k / ranks of the total, assuming a uniform cost within each band
+		const double target = total * double(k) / double(ranks);
+		double cumulative = 0;
+		std::size_t j = 0;
+		while (j < ranks - 1 && cumulative + seconds[j] < target) {
+			cumulative += seconds[j++];
+		}
+		const double fraction = seconds[j] > 0 ? (target - cumulative) / seconds[j] : 0.5;
+		const auto target_row = boundaries[j] + static_cast<unsigned long>(fraction * double(rows[j]));
+		if (target_row < boundaries[k]) {
+			balanced[k] = std::max(target_row, boundaries[k] - (rows[k - 1] - 1) / 2);
+		} else {
+			balanced[k] = std::min(target_row, boundaries[k] + (rows[k] - 1) / 2);
+		}
+	}
+	return balanced;
+}
+
+bool RowBalancer::rebalance(PGM_HOLDER& chunk, PGM_HOLDER& next_chunk, unsigned long& first_row, const unsigned long row_length,
+							const unsigned int step, mpi::communicator world)
+{
+	if (!period || step % period || world.size() == 1) {
+		return false;
+	}
+	Trace::Span span{"rebalance"};
+	const unsigned long stride = PgmUtils::row_stride(row_length);
+	const unsigned long rows = chunk.size() / stride - 2;
+	std::vector<unsigned long> all_rows;
+	std::vector<double> all_seconds;
+	mpi::all_gather(world, rows, all_rows);
+	mpi::all_gather(world, accumulated, all_seconds);
+	accumulated = 0;
+
+	const double slowest = *std::max_element(all_seconds.begin(), all_seconds.end());
+	const double average = std::accumulate(all_seconds.begin(), all_seconds.end(), 0.0) / world.size();
+	// evening out saves the excess of the slowest rank at every period, which must pay for the last move
+	if (slowest <= (1 + tolerance) * average || slowest - average <= migration_seconds) {
+		return false;
+	}
+	const auto old_boundaries = [&all_rows]() {
+		std::vector<unsigned long> boundaries(all_rows.size() + 1, 0);
+		std::partial_sum(all_rows.begin(), all_rows.end(), boundaries.begin() + 1);
+		return boundaries;
+	}();
+	const auto new_boundaries = balanced_boundaries(all_rows, all_seconds);
+	if (new_boundaries == old_boundaries) {
+		return false;
+	}
+
+	const double start = MPI_Wtime();
+	const int rank = world.rank();
+	const auto old_first = old_boundaries[rank], old_end = old_boundaries[rank + 1];
+	const auto new_first = new_boundaries[rank], new_end = new_boundaries[rank + 1];
+	ChunkMemory *memory = chunk.get_allocator().backing();
+	// filled by this thread and MPI, so zeroed by the threads that compute on it
+	PGM_HOLDER balanced_chunk = PgmUtils::allocate_chunk(new_end - new_first, row_length, memory);
+	// address of a global row within the rows of a chunk starting at global row first
+	const auto row = [stride](PGM_HOLDER& c, unsigned long first, unsigned long global_row) {
+		return c.data() + (global_row - first + 1) * stride;
+	};
+
+	MPI_Datatype row_type;
+	MPI_Type_contiguous(int(stride), MPI_UNSIGNED_CHAR, &row_type);
+	MPI_Type_commit(&row_type);
+	const MPI_Comm comm = static_cast<MPI_Comm>(world);
+	std::vector<MPI_Request> requests;
+	const auto transfer = [&](bool send, unsigned long from, unsigned long to, int peer) {
+		requests.emplace_back();
+		if (send) {
+			MPI_Isend(row(chunk, old_first, from), int(to - from), row_type, peer, MIGRATED_ROWS, comm, &requests.back());
+		} else {
+			MPI_Irecv(row(balanced_chunk, new_first, from), int(to - from), row_type, peer, MIGRATED_ROWS, comm, &requests.back());
+		}
+	};
+	if (new_first < old_first) {
+		transfer(false, new_first, old_first, rank - 1);
+	} else if (new_first > old_first) {
+		transfer(true, old_first, new_first, rank - 1);
+	}
+	if (new_end > old_end) {
+		transfer(false, old_end, new_end, rank + 1);
+	} else if (new_end < old_end) {
+		transfer(true, new_end, old_end, rank + 1);
+	}
+	const auto kept_first = std::max(old_first, new_first), kept_end = std::min(old_end, new_end);
+	if (kept_first < kept_end) {
+		std::copy(row(chunk, old_first, kept_first), row(chunk, old_first, kept_end), row(balanced_chunk, new_first, kept_first));
+	}
+	MPI_Waitall(int(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+	MPI_Type_free(&row_type);
+
+	chunk.swap(balanced_chunk);
+	if (!next_chunk.empty()) {
+		next_chunk = PgmUtils::allocate_chunk(new_end - new_first, row_length, memory, false);
+	}
+	first_row = new_first;
+	migration_seconds = mpi::all_reduce(world, MPI_Wtime() - start, mpi::maximum<double>());
+	return true;
+}
@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <fstream>
+#include <boost/serialization/vector.hpp>
+#include <Thumbnail.hpp>
+
+namespace mpi = boost::mpi;
+
+Thumbnail::Thumbnail(unsigned long size, unsigned long pixels)
+	: grid_size{size}, resolution{std::min(pixels, size)}, boundaries(resolution + 1)
+{
+	for (auto k = 1UL; k <= resolution; k++) {
+		boundaries[k] = k * grid_size / resolution;
+	}
+}
+
+unsigned long Thumbnail::pixel_of(unsigned long cell) const
+{
+	return std::upper_bound(boundaries.begin(), boundaries.end(), cell) - boundaries.begin() - 1;
+}
+
+void Thumbnail::save(const std::string& filename, const PGM_HOLDER& chunk, unsigned long first_row,
+					mpi::communicator world) const
+{
+	const auto stride = PgmUtils::row_stride(grid_size);
+	const auto end_row = first_row + chunk.size() / stride - 2;
+	const auto first_pixel_row = pixel_of(first_row), end_pixel_row = pixel_of(end_row - 1) + 1;
+	std::vector<std::uint64_t> counts((end_pixel_row - first_pixel_row) * resolution, 0);
+#pragma omp parallel for schedule(static)
+	for (auto y = first_pixel_row; y < end_pixel_row; y++) {
+		std::uint64_t *pixels = counts.data() + (y - first_pixel_row) * resolution;
+		for (auto row = std::max(boundaries[y], first_row); row < std::min(boundaries[y + 1], end_row); row++) {
+			const unsigned char *cells = chunk.data() + (row - first_row + 1) * stride + 1;
+			for (auto x = 0UL; x < resolution; x++) {
+				std::uint64_t alive = 0;
+				for (auto c = boundaries[x]; c < boundaries[x + 1]; c++) {
+					alive += cells[c] == PGM_MAX_VALUE;
+				}
+				pixels[x] += alive;
+			}
+		}
+	}
+
+	// pixel rows shared by two ranks get a partial count from each
+	std::vector<unsigned long> all_first_pixel_rows;
+	std::vector<std::vector<std::uint64_t>> all_counts;
+	mpi::gather(world, first_pixel_row, all_first_pixel_rows, 0);
+	mpi::gather(world, counts, all_counts, 0);
+	if (world.rank()) {
+		return;
+	}
+	std::vector<std::uint64_t> totals(resolution * resolution, 0);
+	for (std::size_t r = 0; r < all_counts.size(); r++) {
+		std::transform(all_counts[r].begin(), all_counts[r].end(), totals.begin() + all_first_pixel_rows[r] * resolution,
+					totals.begin() + all_first_pixel_rows[r] * resolution, std::plus<std::uint64_t>());
+	}
+	std::vector<unsigned char> image(resolution * resolution);
+	for (auto y = 0UL; y < resolution; y++) {
+		for (auto x = 0UL; x < resolution; x++) {
+			const auto cells = (boundaries[y + 1] - boundaries[y]) * (boundaries[x + 1] - boundaries[x]);
+			image[y * resolution + x] = static_cast<unsigned char>((totals[y * resolution + x] * PGM_MAX_VALUE + cells / 2) / cells);
+		}
+	}
+	const SIZE_HOLDER dimensions{resolution, resolution};
+	PgmUtils::write_header(filename, dimensions);
+	std::ofstream outstream{filename.c_str(), std::ios_base::binary | std::ios_base::app};
+	outstream.write(reinterpret_cast<const char*>(image.data()), std::streamsize(image.size()));
+}
@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <zlib.h>
+#include <TiledGrid.hpp>
+
+// a single byte for uniform tiles, or else the cells packed one bit each and deflated; empty if deflating failed
+static std::vector<unsigned char> encode_tile(const unsigned char *cells, unsigned long row_length,
+											unsigned long width, unsigned long height, std::uint32_t& codec)
+{
+	bool uniform = true;
+	for (auto r = 0UL; r < height && uniform; r++) {
+		const unsigned char *row = cells + r * row_length;
+		uniform = std::all_of(row, row + width, [cells](unsigned char cell) { return cell == cells[0]; });
+	}
+	if (uniform) {
+		codec = TiledGrid::UNIFORM;
+		return { cells[0] };
+	}
+	std::vector<unsigned char> bits((width * height + 7) / 8, 0);
+	for (auto r = 0UL; r < height; r++) {
+		for (auto c = 0UL; c < width; c++) {
+			const auto i = r * width + c;
+			bits[i / 8] |= (cells[r * row_length + c] == PGM_MAX_VALUE) << (i % 8);
+		}
+	}
+	uLongf length = compressBound(uLong(bits.size()));
+	std::vector<unsigned char> deflated(length);
+	if (compress2(deflated.data(), &length, bits.data(), uLong(bits.size()), Z_BEST_SPEED) != Z_OK) {
+		return {};
+	}
+	deflated.resize(length);
+	codec = TiledGrid::BITPACK_DEFLATE;
+	return deflated;
+}
+
+// false if the tile is corrupt
+static bool decode_tile(const std::vector<unsigned char>& encoded, std::uint32_t codec, unsigned long width,
+						unsigned long height, unsigned char *cells)
+{
+	if (codec == TiledGrid::UNIFORM) {
+		if (encoded.size() != 1) {
+			return false;
+		}
+		std::fill(cells, cells + width * height, encoded[0]);
+		return true;
+	}
+	std::vector<unsigned char> bits((width * height + 7) / 8);
+	uLongf length = uLongf(bits.size());
+	if (codec != TiledGrid::BITPACK_DEFLATE
+		|| uncompress(bits.data(), &length, encoded.data(), uLong(encoded.size())) != Z_OK || length != bits.size()) {
+		return false;
+	}
+	for (auto i = 0UL; i < width * height; i++) {
+		cells[i] = (bits[i / 8] >> (i % 8) & 1) ? PGM_MAX_VALUE : 0;
+	}
+	return true;
+}
+
+bool TiledGrid::write_chunk_to_file(const std::string& filename, const PGM_HOLDER& chunk, unsigned long first_row,
+									unsigned long row_length, unsigned long tile_size, MPI_Comm comm)
+{
+	int rank, ranks;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &ranks);
+	const auto stride = PgmUtils::row_stride(row_length);
+	const unsigned long band[2] = { first_row, chunk.size() / stride - 2 };
+	std::vector<unsigned long> bands(2 * std::size_t(ranks));
+	MPI_Allgather(band, 2, MPI_UNSIGNED_LONG, bands.data(), 2, MPI_UNSIGNED_LONG, comm);
+	const auto height = bands[2 * std::size_t(ranks) - 2] + bands[2 * std::size_t(ranks) - 1];
+	const auto tiles_x = (row_length + tile_size - 1) / tile_size;
+	const auto tiles_y = (height + tile_size - 1) / tile_size;
+
+	// a tile row belongs to the rank holding its first row, which gets the rest of it from the next ranks
+	const auto tile_rows_of = [&](int r) {
+		const auto first = bands[2 * std::size_t(r)], end = first + bands[2 * std::size_t(r) + 1];
+		return std::make_pair((first + tile_size - 1) / tile_size, (end + tile_size - 1) / tile_size);
+	};
+	const auto rows_of = [&](int r) {
+		const auto [first_tile_row, end_tile_row] = tile_rows_of(r);
+		return std::make_pair(first_tile_row * tile_size, std::min(end_tile_row * tile_size, height));
+	};
+	std::vector<unsigned char> band_cells(band[1] * row_length);
+	for (auto r = 0UL; r < band[1]; r++) {
+		std::memcpy(band_cells.data() + r * row_length, chunk.data() + (r + 1) * stride + 1, row_length);
+	}
+	const auto [needed_first, needed_end] = rows_of(rank);
+	std::vector<unsigned char> cells((needed_end - needed_first) * row_length);
+	std::vector<int> send_counts(ranks), send_displs(ranks), recv_counts(ranks), recv_displs(ranks);
+	for (int r = 0; r < ranks; r++) {
+		const auto [first, end] = rows_of(r);
+		const auto send_first = std::max(first, band[0]), send_end = std::min(end, band[0] + band[1]);
+		send_counts[r] = send_first < send_end ? int(send_end - send_first) : 0;
+		send_displs[r] = send_first < send_end ? int(send_first - band[0]) : 0;
+		const auto recv_first = std::max(needed_first, bands[2 * std::size_t(r)]);
+		const auto recv_end = std::min(needed_end, bands[2 * std::size_t(r)] + bands[2 * std::size_t(r) + 1]);
+		recv_counts[r] = recv_first < recv_end ? int(recv_end - recv_first) : 0;
+		recv_displs[r] = recv_first < recv_end ? int(recv_first - needed_first) : 0;
+	}
+	MPI_Datatype row_type;
+	MPI_Type_contiguous(int(row_length), MPI_UNSIGNED_CHAR, &row_type);
+	MPI_Type_commit(&row_type);
+	MPI_Alltoallv(band_cells.data(), send_counts.data(), send_displs.data(), row_type,
+				cells.data(), recv_counts.data(), recv_displs.data(), row_type, comm);
+	MPI_Type_free(&row_type);
+
+	const auto [first_tile_row, end_tile_row] = tile_rows_of(rank);
+	const long tiles = long((end_tile_row - first_tile_row) * tiles_x);
+	std::vector<std::vector<unsigned char>> encoded(tiles);
+	std::vector<Entry> entries(tiles);
+#pragma omp parallel for schedule(dynamic)
+	for (long t = 0; t < tiles; t++) {
+		const auto ty = first_tile_row + t / tiles_x, tx = t % tiles_x;
+		const auto width = std::min(tile_size, row_length - tx * tile_size);
+		const auto tile_height = std::min(tile_size, height - ty * tile_size);
+		const unsigned char *tile = cells.data() + (ty * tile_size - needed_first) * row_length + tx * tile_size;
+		encoded[t] = encode_tile(tile, row_length, width, tile_height, entries[t].codec);
+	}
+	int encoded_all = std::none_of(encoded.begin(), encoded.end(), [](const auto& tile) { return tile.empty(); });
+	MPI_Allreduce(MPI_IN_PLACE, &encoded_all, 1, MPI_INT, MPI_MIN, comm);
+	if (!encoded_all) {
+		return false;
+	}
+
+	// the tiles of the ranks follow each other in rank order, hence the offsets from a prefix sum
+	std::uint64_t bytes = 0, start = 0, data_end = 0;
+	for (long t = 0; t < tiles; t++) {
+		bytes += encoded[t].size();
+	}
+	MPI_Exscan(&bytes, &start, 1, MPI_UINT64_T, MPI_SUM, comm);
+	start = rank ? start + TILED_HEADER_LENGTH : TILED_HEADER_LENGTH;
+	MPI_Allreduce(&bytes, &data_end, 1, MPI_UINT64_T, MPI_SUM, comm);
+	data_end += TILED_HEADER_LENGTH;
+	std::vector<unsigned char> data;
+	data.reserve(bytes);
+	for (long t = 0; t < tiles; t++) {
+		entries[t].offset = start + data.size();
+		entries[t].length = std::uint32_t(encoded[t].size());
+		data.insert(data.end(), encoded[t].begin(), encoded[t].end());
+	}
+
+	std::vector<int> entry_bytes(ranks), entry_displs(ranks);
+	const int own_entry_bytes = int(tiles * long(sizeof(Entry)));
+	MPI_Gather(&own_entry_bytes, 1, MPI_INT, entry_bytes.data(), 1, MPI_INT, 0, comm);
+	for (int r = 1; r < ranks; r++) {
+		entry_displs[r] = entry_displs[r - 1] + entry_bytes[r - 1];
+	}
+	std::vector<Entry> index(rank ? 0 : tiles_x * tiles_y);
+	MPI_Gatherv(entries.data(), own_entry_bytes, MPI_BYTE, index.data(), entry_bytes.data(), entry_displs.data(), MPI_BYTE, 0, comm);
+
+	MPI_File file;
+	MPI_File_open(comm, filename.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+	MPI_File_set_size(file, MPI_Offset(data_end + tiles_x * tiles_y * sizeof(Entry) + sizeof(std::uint64_t) + 8));
+	MPI_File_write_at_all(file, MPI_Offset(start), data.data(), int(data.size()), MPI_BYTE, MPI_STATUS_IGNORE);
+	if (!rank) {
+		unsigned char header[TILED_HEADER_LENGTH] = {};
+		const std::uint64_t dimensions[3] = { row_length, height, tile_size };
+		std::memcpy(header, TILED_GRID_MAGIC, 8);
+		std::memcpy(header + 8, dimensions, sizeof(dimensions));
+		MPI_File_write_at(file, 0, header, TILED_HEADER_LENGTH, MPI_BYTE, MPI_STATUS_IGNORE);
+		MPI_File_write_at(file, MPI_Offset(data_end), index.data(), int(index.size() * sizeof(Entry)), MPI_BYTE, MPI_STATUS_IGNORE);
+		unsigned char tail[sizeof(std::uint64_t) + 8];
+		std::memcpy(tail, &data_end, sizeof(std::uint64_t));
+		std::memcpy(tail + sizeof(std::uint64_t), TILED_INDEX_MAGIC, 8);
+		MPI_File_write_at(file, MPI_Offset(data_end + index.size() * sizeof(Entry)), tail, sizeof(tail), MPI_BYTE, MPI_STATUS_IGNORE);
+	}
+	MPI_File_close(&file);
+	return true;
+}
+
+bool TiledGrid::read_index(const std::string& filename, Index& index)
+{
+	std::ifstream instream{filename.c_str(), std::ios_base::binary};
+	char magic[8];
+	std::uint64_t dimensions[3];
+	if (!instream.read(magic, 8) || std::memcmp(magic, TILED_GRID_MAGIC, 8)
+		|| !instream.read(reinterpret_cast<char*>(dimensions), sizeof(dimensions))) {
+		return false;
+	}
+	index.width = dimensions[0];
+	index.height = dimensions[1];
+	index.tile_size = dimensions[2];
+	std::uint64_t index_offset;
+	instream.seekg(-std::streamoff(sizeof(std::uint64_t) + 8), std::ios_base::end);
+	if (!instream.read(reinterpret_cast<char*>(&index_offset), sizeof(index_offset))
+		|| !instream.read(magic, 8) || std::memcmp(magic, TILED_INDEX_MAGIC, 8) || !index.tile_size) {
+		return false;
+	}
+	const auto tiles_x = (index.width + index.tile_size - 1) / index.tile_size;
+	const auto tiles_y = (index.height + index.tile_size - 1) / index.tile_size;
+	index.tiles.resize(tiles_x * tiles_y);
+	instream.seekg(std::streamoff(index_offset));
+	return bool(instream.read(reinterpret_cast<char*>(index.tiles.data()), std::streamsize(index.tiles.size() * sizeof(Entry))));
+}
+
+bool TiledGrid::read_region(const std::string& filename, const Index& index, unsigned long x, unsigned long y,
+							unsigned long width, unsigned long height, std::vector<unsigned char>& region)
+{
+	const auto tile_size = index.tile_size;
+	const auto tiles_x = (index.width + tile_size - 1) / tile_size;
+	const auto first_tx = x / tile_size, end_tx = (x + width - 1) / tile_size + 1;
+	const auto first_ty = y / tile_size, end_ty = (y + height - 1) / tile_size + 1;
+	const auto columns = end_tx - first_tx;
+	const long tiles = long((end_ty - first_ty) * columns);
+
+	// the encoded tiles are fetched one after the other, then decoded in parallel
+	std::vector<std::vector<unsigned char>> encoded(tiles);
+	std::ifstream instream{filename.c_str(), std::ios_base::binary};
+	for (long t = 0; t < tiles; t++) {
+		const auto& entry = index.tiles[(first_ty + t / columns) * tiles_x + first_tx + t % columns];
+		encoded[t].resize(entry.length);
+		instream.seekg(std::streamoff(entry.offset));
+		if (!instream.read(reinterpret_cast<char*>(encoded[t].data()), std::streamsize(entry.length))) {
+			return false;
+		}
+	}
+	region.assign(width * height, 0);
+	bool decoded = true;
+#pragma omp parallel for schedule(dynamic) reduction(&&: decoded)
+	for (long t = 0; t < tiles; t++) {
+		const auto ty = first_ty + t / columns, tx = first_tx + t % columns;
+		const auto tile_width = std::min(tile_size, index.width - tx * tile_size);
+		const auto tile_height = std::min(tile_size, index.height - ty * tile_size);
+		std::vector<unsigned char> tile(tile_width * tile_height);
+		if (!decode_tile(encoded[t], index.tiles[ty * tiles_x + tx].codec, tile_width, tile_height, tile.data())) {
+			decoded = false;
+			continue;
+		}
+		const auto row_first = std::max(y, ty * tile_size), row_end = std::min(y + height, ty * tile_size + tile_height);
+		const auto column_first = std::max(x, tx * tile_size), column_end = std::min(x + width, tx * tile_size + tile_width);
+		for (auto row = row_first; row < row_end; row++) {
+			std::memcpy(region.data() + (row - y) * width + (column_first - x),
+						tile.data() + (row - ty * tile_size) * tile_width + (column_first - tx * tile_size), column_end - column_first);
+		}
+	}
+	return decoded;
+}
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+#include <omp.h>
+#include <Trace.hpp>
+
+#define CLOCK_ROUNDS	16
+#define CLOCK_TAG		7
+
+namespace {
+
+	struct Event {
+		const char *name;
+		double begin;
+		double end;
+		int peer;
+		unsigned long bytes;
+	};
+
+	struct Buffer {
+		int omp_thread;
+		std::size_t recorded;
+		std::vector<Event> events;
+	};
+
+	std::size_t capacity;
+	std::mutex registration;
+	std::vector<std::unique_ptr<Buffer>> buffers;
+	thread_local Buffer *own_buffer = nullptr;
+
+	double start_time;
+	double start_offset;
+}
+
+bool Trace::active = false;
+
+// the buffer of the calling thread, registered on its first span
+static Buffer& own()
+{
+	if (!own_buffer) {
+		std::lock_guard<std::mutex> lock{registration};
+		buffers.push_back(std::make_unique<Buffer>(Buffer{ omp_get_thread_num(), 0, std::vector<Event>(capacity) }));
+		own_buffer = buffers.back().get();
+	}
+	return *own_buffer;
+}
+
+// seconds to add to MPI_Wtime() of the calling rank to get the one of rank 0, from the round trip
+// with the shortest delay; collective
+static double clock_offset(MPI_Comm comm)
+{
+	int rank, ranks;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &ranks);
+	double offset = 0;
+	if (!rank) {
+		for (int peer = 1; peer < ranks; peer++) {
+			for (int round = 0; round < CLOCK_ROUNDS; round++) {
+				MPI_Recv(nullptr, 0, MPI_BYTE, peer, CLOCK_TAG, comm, MPI_STATUS_IGNORE);
+				const double now = MPI_Wtime();
+				MPI_Send(&now, 1, MPI_DOUBLE, peer, CLOCK_TAG, comm);
+			}
+		}
+	} else {
+		double shortest = -1;
+		for (int round = 0; round < CLOCK_ROUNDS; round++) {
+			const double sent = MPI_Wtime();
+			double remote;
+			MPI_Send(nullptr, 0, MPI_BYTE, 0, CLOCK_TAG, comm);
+			MPI_Recv(&remote, 1, MPI_DOUBLE, 0, CLOCK_TAG, comm, MPI_STATUS_IGNORE);
+			const double received = MPI_Wtime();
+			if (shortest < 0 || received - sent < shortest) {
+				shortest = received - sent;
+				offset = remote - (sent + received) / 2;
+			}
+		}
+	}
+	return offset;
+}
+
+void Trace::start(std::size_t events_per_thread, MPI_Comm comm)
+{
+	capacity = events_per_thread;
+	start_offset = clock_offset(comm);
+	start_time = MPI_Wtime();
+	active = capacity > 0;
+	if (active) {
+		// the thread of MPI gets the first tid
+		own();
+	}
+}
+
+void Trace::record(const char *name, double begin, double end, int peer, unsigned long bytes)
+{
+	auto& buffer = own();
+	buffer.events[buffer.recorded++ % capacity] = { name, begin, end, peer, bytes };
+}
+
+void Trace::write(const std::string& filename, MPI_Comm comm)
+{
+	if (!active) {
+		return;
+	}
+	active = false;
+	const double end_offset = clock_offset(comm);
+	const double end_time = MPI_Wtime();
+	const double drift = end_time > start_time ? (end_offset - start_offset) / (end_time - start_time) : 0.0;
+	// microseconds on the clock of rank 0
+	const auto global_us = [drift](double local) { return (local + start_offset + (local - start_time) * drift) * 1e6; };
+
+	int rank;
+	MPI_Comm_rank(comm, &rank);
+	std::ostringstream json;
+	json.precision(15);
+	json << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << rank << ",\"args\":{\"name\":\"rank " << rank << "\"}},\n";
+	for (std::size_t tid = 0; tid < buffers.size(); tid++) {
+		const auto& buffer = *buffers[tid];
+		json << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << rank << ",\"tid\":" << tid
+			<< ",\"args\":{\"name\":\"" << (tid ? "OpenMP thread " + std::to_string(buffer.omp_thread) : std::string{"main"}) << "\"}},\n";
+		const auto kept = std::min(buffer.recorded, capacity);
+		for (auto k = buffer.recorded - kept; k < buffer.recorded; k++) {
+			const auto& event = buffer.events[k % capacity];
+			json << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":" << rank << ",\"tid\":" << tid
+				<< ",\"ts\":" << global_us(event.begin) << ",\"dur\":" << (event.end - event.begin) * 1e6;
+			if (event.peer >= 0 || event.bytes) {
+				json << ",\"args\":{\"peer\":" << event.peer << ",\"bytes\":" << event.bytes << "}";
+			}
+			json << "},\n";
+		}
+	}
+	const std::string text = json.str();
+
+	int ranks;
+	MPI_Comm_size(comm, &ranks);
+	int length = int(text.size());
+	std::vector<int> lengths(std::size_t(rank ? 0 : ranks)), displacements(lengths.size() + 1, 0);
+	MPI_Gather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, 0, comm);
+	for (std::size_t r = 0; r < lengths.size(); r++) {
+		displacements[r + 1] = displacements[r] + lengths[r];
+	}
+	std::string all(std::size_t(rank ? 0 : displacements.back()), '\0');
+	MPI_Gatherv(text.data(), length, MPI_CHAR, all.data(), lengths.data(), displacements.data(), MPI_CHAR, 0, comm);
+	if (!rank) {
+		// the last event must not be followed by a comma
+		all.erase(all.find_last_of(','));
+		std::ofstream out{filename, std::ios_base::trunc};
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" << all << "\n]}\n";
+	}
+}
@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <UringWriter.hpp>
+
+struct UringWriter::File {
+	int direct_fd;
+	int buffered_fd;
+
+	~File()
+	{
+		if (direct_fd >= 0) {
+			close(direct_fd);
+		}
+		close(buffered_fd);
+	}
+};
+
+// false, after reporting why, if the range could not be written
+static bool write_buffered(int fd, const unsigned char *data, std::size_t length, unsigned long long offset)
+{
+	while (length) {
+		const auto written = pwrite(fd, data, length, off_t(offset));
+		if (written < 0 && errno == EINTR) {
+			continue;
+		}
+		if (written <= 0) {
+			std::perror(written ? "snapshot write" : "snapshot write: no progress");
+			return false;
+		}
+		data += written;
+		length -= std::size_t(written);
+		offset += std::size_t(written);
+	}
+	return true;
+}
+
+// copies the cells [first, end) of the rows of chunk, counted from its first cell, into destination
+static void pack_cells(const PGM_HOLDER& chunk, unsigned long row_length, unsigned long first, unsigned long end,
+					unsigned char *destination)
+{
+	const auto stride = PgmUtils::row_stride(row_length);
+	while (first < end) {
+		const auto row = first / row_length, column = first % row_length;
+		const auto length = std::min(row_length - column, end - first);
+		std::memcpy(destination, chunk.data() + (row + 1) * stride + 1 + column, length);
+		destination += length;
+		first += length;
+	}
+}
+
+UringWriter::UringWriter(unsigned int depth, std::size_t staging_size)
+	: ring_fd{-1}, sq_ring{MAP_FAILED}, cq_ring{MAP_FAILED}, sq_ring_size{0}, cq_ring_size{0}, sqes_size{0},
+	buffer_size{staging_size / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT}, in_flight{0}, ok{true}
+{
+	io_uring_params params{};
+	ring_fd = int(syscall(__NR_io_uring_setup, depth, &params));
+	if (ring_fd < 0) {
+		return;
+	}
+	sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+	cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+	if (single_mmap) {
+		sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+	}
+	sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+	cq_ring = single_mmap ? sq_ring
+		: mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+	sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+	void *sqe_area = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+						MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+	if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqe_area == MAP_FAILED) {
+		close(ring_fd);
+		ring_fd = -1;
+		return;
+	}
+	const auto sq = static_cast<unsigned char*>(sq_ring), cq = static_cast<unsigned char*>(cq_ring);
+	sq_tail = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+	sq_mask = reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+	sq_array = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+	cq_head = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+	cq_tail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+	cq_mask = reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+	cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+	sqes = static_cast<io_uring_sqe*>(sqe_area);
+
+	buffers.resize(std::min(depth, params.sq_entries));
+	for (std::size_t b = 0; b < buffers.size(); b++) {
+		buffers[b].data = static_cast<unsigned char*>(std::aligned_alloc(DIRECT_IO_ALIGNMENT, buffer_size));
+		if (!buffers[b].data) {
+			std::perror("io_uring staging buffers");
+			release_ring();
+			return;
+		}
+		free_buffers.push_back(b);
+	}
+}
+
+UringWriter::~UringWriter()
+{
+	drain();
+	for (auto& staging : buffers) {
+		std::free(staging.data);
+	}
+	release_ring();
+}
+
+void UringWriter::release_ring()
+{
+	if (ring_fd < 0) {
+		return;
+	}
+	munmap(sqes, sqes_size);
+	if (cq_ring != sq_ring) {
+		munmap(cq_ring, cq_ring_size);
+	}
+	munmap(sq_ring, sq_ring_size);
+	close(ring_fd);
+	ring_fd = -1;
+}
+
+void UringWriter::abandon()
+{
+	std::vector<bool> idle(buffers.size(), false);
+	for (const auto b : free_buffers) {
+		idle[b] = true;
+	}
+	for (std::size_t b = 0; b < buffers.size(); b++) {
+		if (!idle[b]) {
+			// the kernel may still read it
+			buffers[b].data = nullptr;
+			buffers[b].file.reset();
+		}
+	}
+	in_flight = 0;
+	ok = false;
+	release_ring();
+}
+
+bool UringWriter::direct() const
+{
+	return ring_fd >= 0;
+}
+
+void UringWriter::submit(Staging& staging)
+{
+	const unsigned int tail = *sq_tail;
+	const unsigned int slot = tail & *sq_mask;
+	io_uring_sqe& sqe = sqes[slot];
+	std::memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = IORING_OP_WRITE;
+	sqe.fd = staging.file->direct_fd;
+	sqe.addr = reinterpret_cast<unsigned long long>(staging.data);
+	sqe.len = unsigned(staging.length);
+	sqe.off = staging.offset;
+	sqe.user_data = std::size_t(&staging - buffers.data());
+	sq_array[slot] = slot;
+	__atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+	long submitted;
+	do {
+		submitted = syscall(__NR_io_uring_enter, ring_fd, 1, 0, 0, nullptr, 0);
+	} while (submitted < 0 && errno == EINTR);
+	if (submitted == 1) {
+		in_flight++;
+		return;
+	}
+	// the kernel did not take the entry: withdraw it and write the buffer here instead
+	__atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+	if (!write_buffered(staging.file->buffered_fd, staging.data, staging.length, staging.offset)) {
+		ok = false;
+	}
+	staging.file.reset();
+	free_buffers.push_back(std::size_t(&staging - buffers.data()));
+}
+
+void UringWriter::complete_one()
+{
+	unsigned int head = *cq_head;
+	while (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+		if (syscall(__NR_io_uring_enter, ring_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR) {
+			std::perror("io_uring_enter");
+			abandon();
+			return;
+		}
+	}
+	const io_uring_cqe& cqe = cqes[head & *cq_mask];
+	Staging& staging = buffers[cqe.user_data];
+	const std::size_t written = cqe.res > 0 ? std::size_t(cqe.res) : 0;
+	if (written < staging.length
+		&& !write_buffered(staging.file->buffered_fd, staging.data + written, staging.length - written, staging.offset + written)) {
+		ok = false;
+	}
+	__atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+	staging.file.reset();
+	free_buffers.push_back(std::size_t(&staging - buffers.data()));
+	in_flight--;
+}
+
+bool UringWriter::drain()
+{
+	while (in_flight) {
+		complete_one();
+	}
+	return ok;
+}
+
+bool UringWriter::write_chunk(const std::string& filename, const PGM_HOLDER& chunk, std::streampos start_offset,
+							unsigned long row_length)
+{
+	const auto cells = (chunk.size() / PgmUtils::row_stride(row_length) - 2) * row_length;
+	const unsigned long long begin = static_cast<unsigned long long>(start_offset), end = begin + cells;
+	auto file = std::make_shared<File>();
+	file->buffered_fd = open(filename.c_str(), O_WRONLY);
+	file->direct_fd = direct() ? open(filename.c_str(), O_WRONLY | O_DIRECT) : -1;
+
+	// only the blocks entirely within the range of this rank are written directly
+	auto direct_begin = (begin + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+	auto direct_end = end / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+	if (file->direct_fd < 0 || direct_begin >= direct_end) {
+		direct_begin = direct_end = end;
+	}
+	std::vector<unsigned char> edge(std::max(direct_begin - begin, end - direct_end));
+	if (file->buffered_fd < 0) {
+		std::perror(filename.c_str());
+		return ok = false;
+	}
+	pack_cells(chunk, row_length, 0, direct_begin - begin, edge.data());
+	ok = write_buffered(file->buffered_fd, edge.data(), direct_begin - begin, begin) && ok;
+	pack_cells(chunk, row_length, direct_end - begin, cells, edge.data());
+	ok = write_buffered(file->buffered_fd, edge.data(), end - direct_end, direct_end) && ok;
+
+	for (auto offset = direct_begin; offset < direct_end; offset += buffer_size) {
+		if (free_buffers.empty()) {
+			complete_one();
+		}
+		if (!direct()) {
+			// the ring was abandoned, this write has failed already
+			break;
+		}
+		Staging& staging = buffers[free_buffers.back()];
+		free_buffers.pop_back();
+		staging.offset = offset;
+		staging.length = std::min<unsigned long long>(buffer_size, direct_end - offset);
+		staging.file = file;
+		pack_cells(chunk, row_length, offset - begin, offset - begin + staging.length, staging.data);
+		submit(staging);
+	}
+	return ok;
+}
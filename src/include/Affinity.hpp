@@ -0,0 +1,18 @@
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <boost/mpi.hpp>
+
+namespace Affinity {
+
+	/*
+	 * Binds OpenMP thread t to the t-th CPU of the set the rank is allowed to run on (as set up by
+	 * the MPI launcher), unless the OpenMP runtime already binds threads through OMP_PROC_BIND.
+	 * Must run before the chunks are allocated, so that first touch happens on the final CPUs.
+	 */
+	void pin_threads();
+	// rank 0 prints host, CPU and NUMA node of every thread of every rank
+	void report(boost::mpi::communicator world);
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <string>
+#include <vector>
+
+/*
+ * Configurations of the static evolutions (which all compute the same generations) tried by the
+ * autotuner, and the per-host cache of the winners. The cache lives in
+ * $XDG_CACHE_HOME/gol/autotune-<hostname> (~/.cache when unset), one tab-separated line per key:
+ *   cpu model, logical cpus, grid size, ranks, engine, threads, strip width, time block, seconds
+ */
+namespace Autotune {
+
+	struct Configuration {
+		unsigned int engine;
+		unsigned int threads;
+		unsigned long strip_width;
+		unsigned int time_block;
+		double seconds;
+	};
+
+	// engines 1 (with strip widths around the automatic one), 2, 3 and 5 (with several time blocks), for halving thread counts
+	std::vector<Configuration> candidates(unsigned int max_threads, unsigned long automatic_strip_width,
+										unsigned long row_length);
+
+	std::string cache_path();
+	// cpu model, logical cpus, grid size, ranks and threads per rank, tab-separated
+	std::string machine_key(unsigned long grid_size, int ranks, unsigned int threads);
+	bool lookup(const std::string& path, const std::string& key, Configuration& configuration);
+	// replaces the line of key, if any
+	bool store(const std::string& path, const std::string& key, const Configuration& configuration);
+}
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef CACHEINFO_H
+#define CACHEINFO_H
+
+namespace CacheInfo {
+
+	// size in bytes of the data (or unified) cache at the given level, 0 if it cannot be detected
+	unsigned long data_cache_size(unsigned int level);
+	/*
+	 * Width in cells of the column strips the static evolution walks down, so that the three input
+	 * rows and the output row of a strip stay in half of the per-core L2 (L1 if L2 is unknown).
+	 * Returns row_length when whole rows already fit.
+	 */
+	unsigned long strip_width(unsigned long row_length);
+	// rows of the tiles of the blocked evolution, so that both generations of a tile stay in half of the per-core L2
+	unsigned long tile_rows(unsigned long row_stride, unsigned int generations);
+}
+
+#endif
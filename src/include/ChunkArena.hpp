@@ -0,0 +1,36 @@
+#ifndef CHUNKARENA_H
+#define CHUNKARENA_H
+
+#include <cstddef>
+#include <map>
+#include <ChunkMemory.hpp>
+
+/*
+ * Keeps the chunks freed by their holders instead of returning them, and hands them out again to
+ * the next requests of the same size: the swapped and rebalanced chunks of a run and the chunks of
+ * consecutive jobs of the same size then skip the mapping and the page faults. A request of a new
+ * size first returns the cached chunks of other sizes, so that the arena never holds more than one
+ * generation of sizes. Chunks come from upstream, or from the 64-byte aligned heap when nullptr.
+ */
+class ChunkArena : public ChunkMemory {
+public:
+	explicit ChunkArena(ChunkMemory *upstream);
+	~ChunkArena();
+	ChunkArena(const ChunkArena&) = delete;
+	ChunkArena& operator=(const ChunkArena&) = delete;
+
+	void *allocate(std::size_t bytes) override;
+	void deallocate(void *ptr, std::size_t bytes) override;
+
+	// requests served from the cached chunks
+	unsigned long hits() const;
+
+private:
+	void release_cached();
+
+	ChunkMemory *source;
+	std::multimap<std::size_t, void*> cached;
+	unsigned long reused;
+};
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef CHUNKMEMORY_H
+#define CHUNKMEMORY_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <boost/align/aligned_alloc.hpp>
+
+#define CHUNK_ALIGNMENT	64
+
+// Where the cells of a chunk live when they are not plain 64-byte aligned heap memory.
+class ChunkMemory {
+public:
+	virtual ~ChunkMemory() = default;
+	virtual void *allocate(std::size_t bytes) = 0;
+	virtual void deallocate(void *ptr, std::size_t bytes) = 0;
+};
+
+/*
+ * 64-byte aligned allocator, optionally backed by a ChunkMemory. Value-initialized elements are left
+ * uninitialized, so that the pages of a freshly sized chunk are first touched by the threads that
+ * will later compute on them rather than by the allocating one. The backing memory follows the
+ * chunk on swap and move, while copies always go to the heap.
+ */
+template <typename T>
+class chunk_allocator {
+public:
+	typedef T value_type;
+	typedef std::true_type propagate_on_container_swap;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::false_type propagate_on_container_copy_assignment;
+
+	chunk_allocator() noexcept : memory{nullptr} {}
+	explicit chunk_allocator(ChunkMemory *backing) noexcept : memory{backing} {}
+	template <typename U>
+	chunk_allocator(const chunk_allocator<U>& other) noexcept : memory{other.backing()} {}
+
+	chunk_allocator select_on_container_copy_construction() const noexcept
+	{
+		return chunk_allocator{};
+	}
+
+	T *allocate(std::size_t n)
+	{
+		void *ptr = memory ? memory->allocate(n * sizeof(T)) : boost::alignment::aligned_alloc(CHUNK_ALIGNMENT, n * sizeof(T));
+		if (!ptr) {
+			throw std::bad_alloc{};
+		}
+		return static_cast<T*>(ptr);
+	}
+
+	void deallocate(T *ptr, std::size_t n) noexcept
+	{
+		if (memory) {
+			memory->deallocate(ptr, n * sizeof(T));
+		} else {
+			boost::alignment::aligned_free(ptr);
+		}
+	}
+
+	template <typename U>
+	void construct(U *ptr) noexcept(std::is_nothrow_default_constructible<U>::value)
+	{
+		::new (static_cast<void*>(ptr)) U;
+	}
+
+	template <typename U, typename... Args>
+	void construct(U *ptr, Args&&... args)
+	{
+		::new (static_cast<void*>(ptr)) U(std::forward<Args>(args)...);
+	}
+
+	ChunkMemory *backing() const noexcept
+	{
+		return memory;
+	}
+
+private:
+	ChunkMemory *memory;
+};
+
+template <typename T, typename U>
+bool operator==(const chunk_allocator<T>& a, const chunk_allocator<U>& b) noexcept
+{
+	return a.backing() == b.backing();
+}
+
+template <typename T, typename U>
+bool operator!=(const chunk_allocator<T>& a, const chunk_allocator<U>& b) noexcept
+{
+	return !(a == b);
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef CYCLEDETECTOR_H
+#define CYCLEDETECTOR_H
+
+#include <cstdint>
+#include <vector>
+#include <boost/mpi.hpp>
+#include <PgmUtils.hpp>
+
+/*
+ * Detects when the whole grid has become periodic with a period of at most max_period steps.
+ * Each rank hashes its band only during the max_period generations preceding a check step;
+ * every check_period steps the per-period matches are AND-reduced across ranks. A hash match
+ * is only a candidate: the band is copied and the cycle is confirmed by an exact comparison
+ * once the candidate period has elapsed, so a reported period is never a hash collision.
+ */
+class CycleDetector {
+public:
+	CycleDetector(unsigned int max_period, unsigned int check_period);
+
+	// collective, to be called after every step with the band holding the state of that step;
+	// returns the confirmed period, or 0 if the grid is not (yet) known to be periodic
+	unsigned int observe(const PGM_HOLDER& chunk, const unsigned long leading_halo_length,
+						const unsigned int step, boost::mpi::communicator world);
+
+	// whether observe() needs the state of this step
+	bool observes(const unsigned int step) const;
+
+	// forgets the recorded generations, to be called when the bands of the ranks change
+	void reset();
+
+	static std::uint64_t hash_chunk(const PGM_HOLDER& chunk, const unsigned long leading_halo_length);
+
+private:
+	bool wants_hash(const unsigned int step) const;
+
+	unsigned int max_period;
+	unsigned int check_period;
+	std::vector<std::uint64_t> hashes;
+	std::vector<unsigned int> hashed_steps;
+
+	unsigned int candidate_period;
+	unsigned int verification_step;
+	PGM_HOLDER candidate_chunk;
+};
+
+#endif
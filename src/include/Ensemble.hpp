@@ -0,0 +1,47 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <ChunkMemory.hpp>
+
+#define ENSEMBLE_UNIVERSES	64
+
+/*
+ * 64 independent grid_size x grid_size universes evolved at once: bit u of every cell word belongs
+ * to universe u, so a single pass of bitwise adders counts the neighbors of all of them. The grids
+ * wrap around in both directions, like a run over several ranks. Universe u starts from the grid
+ * that -i --seed (first_seed + u) writes.
+ */
+class Ensemble {
+public:
+	struct Statistics {
+		unsigned long initial_population;
+		unsigned long final_population;
+		unsigned int extinction_step;	// first step without live cells, 0 if never
+		unsigned int still_step;		// first step identical to the previous one, 0 if never
+	};
+
+	Ensemble(unsigned long size, std::uint64_t first_seed);
+
+	void evolve();
+	// true once every universe is still, so that further steps would change nothing
+	bool settled() const;
+	std::array<Statistics, ENSEMBLE_UNIVERSES> statistics() const;
+
+private:
+	std::array<unsigned long, ENSEMBLE_UNIVERSES> population() const;
+	void refresh_ghost_rows(std::uint64_t *cells) const;
+
+	unsigned long grid_size;
+	unsigned long stride;
+	std::vector<std::uint64_t, chunk_allocator<std::uint64_t>> current;
+	std::vector<std::uint64_t, chunk_allocator<std::uint64_t>> next;
+	unsigned int step;
+	std::array<unsigned long, ENSEMBLE_UNIVERSES> initial_population;
+	std::array<unsigned int, ENSEMBLE_UNIVERSES> extinction_step;
+	std::array<unsigned int, ENSEMBLE_UNIVERSES> still_step;
+};
+
+#endif
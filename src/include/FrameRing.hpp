@@ -0,0 +1,62 @@
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+#include <cstdint>
+#include <string>
+#include <mpi.h>
+#include <PgmUtils.hpp>
+
+#define FRAME_RING_MAGIC	"GOLRING1"
+
+/*
+ * Generations streamed to viewers on the same node through a POSIX shared-memory object (shm_open
+ * name, e.g. /gol-frames), instead of snapshot files. A frame is the grid point-sampled every scale
+ * cells in both directions, one byte per cell (0 or 255) or, with bits, eight cells per byte (the
+ * leftmost in the lowest bit), row_bytes per row. The object holds a Header, then one cache line per
+ * rank with the frames that rank has published, then slots frames, each one cache line per rank
+ * (its Band) followed by the rows. Frame f goes to slot f % slots; every rank writes the frame rows
+ * whose sampled grid row it holds, between setting the sequence of its band to 2f + 1 and to
+ * 2f + 2, then stores f + 1 in its published line. Writers never wait: a reader takes f one less
+ * than the smallest published count, uses the rows in place if all the bands read 2f + 2, and
+ * drops the frame if they still do not afterwards, the simulation having lapped it.
+ */
+class FrameRing {
+public:
+	struct Header {
+		char magic[8];
+		std::uint32_t width;
+		std::uint32_t height;
+		std::uint32_t scale;
+		std::uint32_t bits;
+		std::uint32_t slots;
+		std::uint32_t ranks;
+		std::uint64_t row_bytes;
+		std::uint64_t slot_bytes;
+		std::uint64_t grid_size;
+	};
+	struct Band {
+		std::uint64_t sequence;
+		std::uint64_t step;
+	};
+
+	// collective; the ranks of comm must share a node
+	FrameRing(const std::string& name, unsigned long grid_size, unsigned int slots, unsigned int scale, bool bits, MPI_Comm comm);
+	~FrameRing();
+	FrameRing(const FrameRing&) = delete;
+	FrameRing& operator=(const FrameRing&) = delete;
+
+	// same result on every rank
+	bool ready() const;
+	// chunk holds the rows of the rank starting at first_row
+	void publish(const PGM_HOLDER& chunk, unsigned long first_row, unsigned long step);
+
+private:
+	unsigned long grid_size;
+	int rank;
+	std::size_t bytes;
+	unsigned char *mapping;
+	Header header;
+	std::uint64_t frames;
+};
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef GOL_H
+#define GOL_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <mpi.h>
+#include <HaloExchange.hpp>
+#include <PgmUtils.hpp>
+
+#define CELL_ALIVE	255
+#define CELL_DEAD	0
+
+/*
+ * Game of Life for programs running simulations in-process (libgol.a) rather than through PGM
+ * files and the gol command line. All the state lives in the objects: a Grid holds the band of rows
+ * of the calling rank, an Engine computes the next generation of a band, and a Simulation advances
+ * a grid with an engine, exchanging the halo rows over an optional communicator and handing the
+ * generations to frame callbacks. Grids wrap around horizontally; vertically they only wrap over
+ * several ranks, like the gol runs, a single band having dead rows above and below it.
+ */
+namespace Gol {
+
+	// columns [begin, end) of a row, 1 being the first cell; the ghost cells make every column alike
+	inline __attribute__((always_inline)) void evolve_cells(const unsigned char *__restrict__ up, const unsigned char *__restrict__ mid,
+															const unsigned char *__restrict__ down, unsigned char *__restrict__ next,
+															unsigned long begin, unsigned long end)
+	{
+#pragma omp simd
+		for (auto c = begin; c < end; c++) {
+			const unsigned char alive_neighbors = (up[c - 1] == CELL_ALIVE) + (up[c] == CELL_ALIVE) + (up[c + 1] == CELL_ALIVE)
+				+ (mid[c - 1] == CELL_ALIVE) + (mid[c + 1] == CELL_ALIVE)
+				+ (down[c - 1] == CELL_ALIVE) + (down[c] == CELL_ALIVE) + (down[c + 1] == CELL_ALIVE);
+			next[c] = (alive_neighbors == 3 || alive_neighbors == 2) ? CELL_ALIVE : CELL_DEAD;
+		}
+	}
+
+	// rows and first row of the band of the calling rank of comm (MPI_COMM_NULL: the whole grid), split like gol does
+	std::pair<unsigned long, unsigned long> band_of(unsigned long height, MPI_Comm comm);
+
+	class Grid {
+	public:
+		// dead cells; memory provides the buffer of the chunk (nullptr: the heap)
+		Grid(unsigned long grid_width, unsigned long band_rows, unsigned long band_first_row = 0, ChunkMemory *memory = nullptr);
+
+		unsigned long width() const;
+		unsigned long rows() const;
+		unsigned long first_row() const;
+
+		// the width cells of row r of the band, CELL_ALIVE or CELL_DEAD; call refresh() after writing them
+		unsigned char *row(unsigned long r);
+		const unsigned char *row(unsigned long r) const;
+		void refresh();
+		// dense rows, width cells each, in and out of the band; load() refreshes
+		void load(const unsigned char *cells);
+		void store(unsigned char *cells) const;
+		unsigned long population() const;
+
+		// the padded rows of the band between its two halo rows, laid out as described in PgmUtils
+		PGM_HOLDER& chunk();
+		const PGM_HOLDER& chunk() const;
+		// copies the chunk into memory; collective if memory is shared between ranks
+		void move_to(ChunkMemory *memory);
+
+	private:
+		unsigned long length;
+		unsigned long height;
+		unsigned long offset;
+		PGM_HOLDER cells;
+	};
+
+	class Engine {
+	public:
+		virtual ~Engine() = default;
+
+		// "static" or "in-place", using threads OpenMP threads (0: the OpenMP default) and column strips of
+		// strip_width cells (0: from the cache sizes); nullptr for an unknown name
+		static std::unique_ptr<Engine> create(const std::string& name, unsigned int threads = 0, unsigned long strip_width = 0);
+
+		// the next generation of the rows of current, whose halo rows are filled, into next (unused if in_place())
+		void evolve(Grid& current, Grid& next);
+		// the same on bare chunks of rows of row_length cells, laid out as described in PgmUtils
+		virtual void evolve_chunk(PGM_HOLDER& current, PGM_HOLDER& next, unsigned long row_length) = 0;
+		virtual bool in_place() const;
+		virtual const char *name() const = 0;
+	};
+
+	class Simulation {
+	public:
+		using Frame = std::function<void(unsigned long generation, const Grid& grid)>;
+
+		// collective over comm (MPI_COMM_NULL: a single band); halo names one of the HaloExchange
+		// implementations, std::invalid_argument otherwise. grid and engine must outlive the simulation
+		Simulation(Grid& grid, Engine& engine, MPI_Comm comm = MPI_COMM_NULL, const std::string& halo = "p2p");
+		// collective if the halo exchange provides the memory of the chunks
+		~Simulation();
+		Simulation(const Simulation&) = delete;
+		Simulation& operator=(const Simulation&) = delete;
+
+		// frame is called with the grid after every generation multiple of period
+		void on_frame(unsigned long period, Frame frame);
+		// collective; advances the grid by n generations
+		void step(unsigned long n = 1);
+		unsigned long generation() const;
+
+	private:
+		Grid& grid;
+		Engine& engine;
+		Grid next;
+		std::unique_ptr<HaloExchange> halo;
+		std::vector<std::pair<unsigned long, Frame>> frames;
+		unsigned long generations;
+	};
+}
+
+#endif
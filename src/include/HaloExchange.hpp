@@ -0,0 +1,64 @@
+#ifndef HALOEXCHANGE_H
+#define HALOEXCHANGE_H
+
+#include <memory>
+#include <string>
+#include <mpi.h>
+#include <PgmUtils.hpp>
+
+#define FIRST_ROW_OF_SENDING_RANK	1
+#define LAST_ROW_OF_SENDING_RANK	2
+
+/*
+ * Fills the two halo rows of a chunk (one row_length-long row above and below the rows of the rank)
+ * with the boundary rows of the previous and next rank; row_length is the padded row stride, so the
+ * ghost cells travel along with the rows. Implementations are selected by name:
+ *   p2p          isend/recv pairs created every step, rank 0 receiving first
+ *   persistent   MPI_Send_init/MPI_Recv_init requests created once per chunk and restarted every step
+ *   rma          MPI_Put of the boundary rows into the neighbors' halos, in post/start/complete/wait epochs
+ *   neighbor     a single MPI_Neighbor_alltoallw over a distributed graph of the two neighbors
+ *   node-shared  chunks in MPI shared-memory windows, halos of same-node neighbors copied directly
+ */
+class HaloExchange {
+public:
+	virtual ~HaloExchange() = default;
+
+	// nullptr for an unknown name
+	static std::unique_ptr<HaloExchange> create(const std::string& name, MPI_Comm world,
+												int prev_rank, int next_rank, unsigned long row_length);
+
+	// where the chunks must be allocated for this implementation (nullptr: anywhere)
+	virtual ChunkMemory *memory();
+	// collective; to be called again whenever the chunks are reallocated or resized. next_chunk is
+	// empty for the engines working in place, which cannot use implementations providing memory()
+	virtual void attach(PGM_HOLDER& chunk, PGM_HOLDER& next_chunk) = 0;
+	// fills the halos of chunk, which must be one of the attached chunks
+	void exchange(PGM_HOLDER& chunk);
+	// to be called once the next generation has been computed from chunk
+	virtual void publish();
+
+	virtual const char *name() const = 0;
+	// time spent in exchange() so far
+	double seconds() const;
+
+protected:
+	HaloExchange(MPI_Comm world, int prev_rank, int next_rank, unsigned long row_length);
+	virtual void exchange_rows(PGM_HOLDER& chunk) = 0;
+
+	// the four rows travelling in an exchange, each one recorded in the trace with its peer
+	enum class Transfer { to_prev, to_next, from_prev, from_next };
+	// a transfer started at begin has just completed
+	void trace(Transfer transfer, double begin) const;
+	// MPI_Waitall of requests carrying transfers, started at begin; null requests are skipped
+	void wait_all(int count, MPI_Request *requests, const Transfer *transfers, double begin) const;
+
+	MPI_Comm world;
+	int prev_rank;
+	int next_rank;
+	unsigned long row_length;
+
+private:
+	double elapsed;
+};
+
+#endif
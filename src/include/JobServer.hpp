@@ -0,0 +1,40 @@
+#ifndef JOBSERVER_H
+#define JOBSERVER_H
+
+#include <string>
+#include <boost/mpi.hpp>
+
+/*
+ * Job queue of a resident gol. Rank 0 listens on a Unix domain socket; clients write one job per
+ * line, made of the options of a -r run (e.g. "-f grid.pgm -n 100 -s 10 -e 1", relative paths being
+ * relative to the working directory of the server), and read back one line per job: its timing CSV
+ * line, or "error: " followed by the reason of the failure. A "shutdown" line stops the server once
+ * the jobs before it are done.
+ */
+class JobServer {
+public:
+	// collective
+	JobServer(const std::string& path, boost::mpi::communicator comm);
+	~JobServer();
+
+	// same result on every rank
+	bool listening() const;
+	// collective; blocks until the next job and returns its line, or an empty string on shutdown or if the
+	// listening socket fails
+	std::string next_job();
+	// answers the current job, only rank 0 does anything
+	void reply(const std::string& lines);
+
+private:
+	bool read_line(std::string& line);
+
+	boost::mpi::communicator world;
+	std::string socket_path;
+	int listen_fd;
+	int client_fd;
+	bool ok;
+	// bytes received from the client past the last line returned
+	std::string pending;
+};
+
+#endif
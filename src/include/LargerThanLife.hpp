@@ -0,0 +1,54 @@
+#ifndef LARGERTHANLIFE_H
+#define LARGERTHANLIFE_H
+
+#include <string>
+#include <vector>
+#include <mpi.h>
+#include <PgmUtils.hpp>
+
+/*
+ * Outer-totalistic automata over the (2 radius + 1)^2 square around every cell, the cell itself
+ * excluded: a dead cell is born when its count of live cells is within [birth_min, birth_max], a
+ * live cell survives when it is within [survival_min, survival_max]. Counts come from sliding box
+ * sums, so their cost does not depend on the radius: every thread keeps the column sums of the
+ * 2 radius + 1 rows around the row it is at, updated by one row entering and one leaving, and sums
+ * them horizontally through prefix sums of the column sums extended by radius columns on either
+ * side (the grid wraps horizontally). The radius rows beyond either end of the band come from the
+ * neighboring ranks, whose bands must be at least radius rows tall.
+ */
+class LargerThanLife {
+public:
+	struct Rule {
+		unsigned long radius;
+		unsigned long birth_min;
+		unsigned long birth_max;
+		unsigned long survival_min;
+		unsigned long survival_max;
+	};
+
+	// "min,max" of a count of neighbors; false if malformed or empty
+	static bool parse_interval(const std::string& text, unsigned long& min, unsigned long& max);
+
+	LargerThanLife(const Rule& automaton_rule, unsigned long length, MPI_Comm comm, int prev, int next);
+
+	// next = one generation after chunk, whose halo rows are left untouched
+	void evolve(const PGM_HOLDER& chunk, PGM_HOLDER& next);
+	// spent exchanging the halo rows so far
+	double seconds() const;
+
+private:
+	// the radius rows above and below the band, from the neighbors (dead cells on a single rank)
+	void exchange(const PGM_HOLDER& chunk);
+
+	Rule rule;
+	unsigned long row_length;
+	unsigned long stride;
+	MPI_Comm world;
+	int prev_rank;
+	int next_rank;
+	std::vector<unsigned char> above;
+	std::vector<unsigned char> below;
+	double elapsed;
+};
+
+#endif
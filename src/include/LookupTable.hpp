@@ -0,0 +1,37 @@
+#ifndef LOOKUPTABLE_H
+#define LOOKUPTABLE_H
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#define LOOKUP_TABLE_SIZE	(1 << 16)
+
+/*
+ * Next state of a 2x2 block of cells from its 4x4 neighborhood, packed into a 16-bit index: four bits
+ * per row from top to bottom, the leftmost cell of each row in the lowest bit. Bits 0 and 1 of an
+ * entry hold the upper row of the block and bits 2 and 3 the lower one, leftmost cell first.
+ * Rows are read from a bit-packed copy, bit j (least significant first) being set if cell j is alive.
+ */
+namespace LookupTable {
+
+	// rule is the next state of a cell given whether it is alive and its number of live neighbors
+	std::array<unsigned char, LOOKUP_TABLE_SIZE> build(bool (*rule)(bool, unsigned int));
+
+	// bytes needed by pack_row for length cells, padding included
+	inline unsigned long packed_length(const unsigned long length)
+	{
+		return (length + 7) / 8 + sizeof(std::uint64_t);
+	}
+	void pack_row(const unsigned char *cells, unsigned long length, unsigned char *bits);
+
+	// cells j to j + 3 of a packed row
+	inline __attribute__((always_inline)) unsigned int nibble(const unsigned char *bits, unsigned long j)
+	{
+		std::uint64_t word;
+		std::memcpy(&word, bits + j / 8, sizeof(word));
+		return (word >> (j % 8)) & 0xF;
+	}
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef MAPPEDCHUNKS_H
+#define MAPPEDCHUNKS_H
+
+#include <cstddef>
+#include <ChunkMemory.hpp>
+
+/*
+ * Backs chunks with their own anonymous mappings, aligned to and rounded up to whole huge pages.
+ * Either transparent huge pages are requested with madvise(MADV_HUGEPAGE), or the mappings come
+ * from the hugetlbfs pool (MAP_HUGETLB); when the pool cannot satisfy a request the chunk falls
+ * back to a transparent huge page mapping, and the fallback is counted.
+ */
+class MappedChunks : public ChunkMemory {
+public:
+	explicit MappedChunks(bool use_hugetlb);
+
+	void *allocate(std::size_t bytes) override;
+	void deallocate(void *ptr, std::size_t bytes) override;
+
+	unsigned long fallbacks() const;
+	// kB of the resident memory of the process backed by huge pages of either kind
+	static unsigned long resident_huge_kb();
+
+private:
+	std::size_t mapping_length(std::size_t bytes) const;
+
+	bool hugetlb;
+	std::size_t huge_page_size;
+	unsigned long hugetlb_failures;
+};
+
+#endif
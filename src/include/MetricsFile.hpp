@@ -0,0 +1,63 @@
+#ifndef METRICSFILE_H
+#define METRICSFILE_H
+
+#include <string>
+#include <vector>
+#include <mpi.h>
+#include <PgmUtils.hpp>
+
+/*
+ * Progress of a run in the Prometheus textfile format, for the textfile collector of a node exporter.
+ * Publication rounds start at steps all ranks agree on: at a round every rank counts its population
+ * and posts a non-blocking gather of its counters to rank 0, together with a non-blocking broadcast
+ * of the steps until the next round, which rank 0 picks from the current rate so that rounds are
+ * about interval seconds apart. The requests complete at the next step, and rank 0 then rewrites
+ * the file (written aside and renamed, so that it is never scraped half written).
+ */
+class MetricsFile {
+public:
+	struct Counters {
+		double compute_seconds;
+		double communication_seconds;
+		double bytes_written;
+	};
+
+	MetricsFile(const std::string& file, double interval_seconds, unsigned int total_steps, unsigned long length, MPI_Comm comm);
+	~MetricsFile();
+	MetricsFile(const MetricsFile&) = delete;
+	MetricsFile& operator=(const MetricsFile&) = delete;
+
+	// collective, after every step (or block of generations), chunk holding the state of step
+	void observe(unsigned int step, const PGM_HOLDER& chunk, const Counters& counters);
+	// collective, once the run is over: publishes the final state
+	void finish(unsigned int step, const PGM_HOLDER& chunk, const Counters& counters);
+
+private:
+	void start_round(unsigned int step, const PGM_HOLDER& chunk, const Counters& counters);
+	void complete_round();
+	void write() const;
+
+	std::string filename;
+	double interval;
+	unsigned int steps;
+	unsigned long row_length;
+	MPI_Comm world;
+	int rank;
+	int ranks;
+
+	bool pending;
+	unsigned int round_step;
+	unsigned int next_round_step;
+	unsigned int stride;
+	MPI_Request requests[2];
+	std::vector<double> sample;
+	std::vector<double> gathered;
+
+	// rank 0: when the last two rounds started, and the rate between them
+	double round_time;
+	unsigned int previous_round_step;
+	double previous_round_time;
+	double start_time;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef NODESHAREDCHUNKS_H
+#define NODESHAREDCHUNKS_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <mpi.h>
+#include <ChunkMemory.hpp>
+
+/*
+ * Backs the chunks of the ranks sharing a node with MPI shared-memory windows (one window per
+ * chunk, allocated collectively over the node communicator), so that a rank can copy the boundary
+ * rows of a neighbor living on the same node straight out of the neighbor's chunk. Every rank of
+ * the node must allocate and free its chunks in the same order. Readers and writers are kept in
+ * step by a per-rank counter of the published generations, also living in shared memory.
+ */
+class NodeSharedChunks : public ChunkMemory {
+public:
+	NodeSharedChunks(MPI_Comm world, int prev_rank, int next_rank);
+	~NodeSharedChunks();
+	NodeSharedChunks(const NodeSharedChunks&) = delete;
+	NodeSharedChunks& operator=(const NodeSharedChunks&) = delete;
+
+	void *allocate(std::size_t bytes) override;
+	void deallocate(void *ptr, std::size_t bytes) override;
+
+	bool prev_on_node() const;
+	bool next_on_node() const;
+	// chunk (and its size in bytes) of the neighbor living in the same window as own_chunk
+	std::pair<const unsigned char*, std::size_t> prev_chunk(const unsigned char *own_chunk) const;
+	std::pair<const unsigned char*, std::size_t> next_chunk(const unsigned char *own_chunk) const;
+
+	// collective; marks the freshly loaded (or reallocated) chunk as readable by the neighbors
+	void publish_loaded();
+	// blocks until the on-node neighbors have published the generation this rank is about to read
+	void wait_for_neighbors();
+	// marks the generation just computed as readable by the neighbors
+	void publish_step();
+
+private:
+	struct Window {
+		MPI_Win win;
+		unsigned char *base;
+		unsigned char *prev_base;
+		unsigned char *next_base;
+		std::size_t prev_bytes;
+		std::size_t next_bytes;
+	};
+
+	const Window& window_of(const unsigned char *own_chunk) const;
+	void publish();
+	void wait_for(const std::uint64_t *flag);
+
+	MPI_Comm node_comm;
+	int node_prev;
+	int node_next;
+	MPI_Win flags_win;
+	std::uint64_t *own_flag;
+	std::uint64_t *prev_flag;
+	std::uint64_t *next_flag;
+	std::uint64_t generation;
+	std::vector<Window> windows;
+};
+
+#endif
@@ -5,24 +5,59 @@
 #include <limits>
 #include <random>
 #include <string>
+#include <utility>
 #include <vector>
 #include <mpi.h>
-#include <boost/align/aligned_allocator.hpp>
+#include <ChunkMemory.hpp>
 
 #define PGM_MAX_VALUE	255
-#define PGM_HOLDER		std::vector<unsigned char, boost::alignment::aligned_allocator<unsigned char, 64>>
+#define PGM_HOLDER		std::vector<unsigned char, chunk_allocator<unsigned char>>
 #define SIZE_HOLDER		std::pair<unsigned long, unsigned long> // width (number of columns) and height (number of rows)
 
 namespace PgmUtils {
 
 	void write_header(const std::string& filename, const SIZE_HOLDER& dimensions);
+	/*
+	 * Chunks hold the rows of a rank plus one halo row above and below them. Every row is
+	 * row_stride(row_length) bytes long: its row_length cells start at column 1, flanked by ghost copies
+	 * of the last cell (column 0) and of the first cell (column row_length + 1), so that the stencil
+	 * needs no wraparound. Files hold dense rows; the conversion happens here, while reading and writing.
+	 */
+	inline unsigned long row_stride(const unsigned long row_length)
+	{
+		return (row_length + 2 + CHUNK_ALIGNMENT - 1) / CHUNK_ALIGNMENT * CHUNK_ALIGNMENT;
+	}
+	inline void refresh_ghost_cells(unsigned char *row, const unsigned long row_length)
+	{
+		row[0] = row[row_length];
+		row[row_length + 1] = row[1];
+	}
+
 	void write_chunk_to_file(const std::string& filename, const PGM_HOLDER& chunk,
-							const std::streampos start_offset, const ulong leading_halo_length,
+							const std::streampos start_offset, const ulong row_length,
 							MPI_Comm comm);
-	PGM_HOLDER read_chunk_from_file(const std::string& filename, const ulong chunk_length,
-									const std::streampos start_offset, const ulong leading_halo_length,
-									MPI_Comm comm);
-	PGM_HOLDER generate_random_chunk(unsigned long size);
+	PGM_HOLDER read_chunk_from_file(const std::string& filename, const ulong rows, const ulong row_length,
+									const std::streampos start_offset, MPI_Comm comm, ChunkMemory *memory = nullptr);
+	// into the rows of an already allocated chunk, leaving its halo rows untouched
+	void read_chunk_from_file(const std::string& filename, PGM_HOLDER& chunk, const ulong row_length,
+							const std::streampos start_offset, MPI_Comm comm);
+	// one draw per cell, in row-major order, so that a seeded grid does not depend on how it is split
+	inline unsigned char random_cell(std::mt19937_64& generator)
+	{
+		return generator() >> 63;
+	}
+	PGM_HOLDER generate_random_chunk(const ulong rows, const ulong row_length, std::mt19937_64& generator);
+
+	// [first, last) of the length items (rows or cells) of a chunk processed by thread out of nthreads
+	inline std::pair<unsigned long, unsigned long> thread_slice(const unsigned long length, const unsigned int thread,
+															const unsigned int nthreads)
+	{
+		return { length * thread / nthreads, length * (thread + 1) / nthreads };
+	}
+	// zero-filled chunk whose pages are first touched with the same static partition of the rows used by the evolvers;
+	// without zeroed_cells only the halo rows, ghost cells and padding are cleared and the cells get a byte per page, for
+	// cells about to be overwritten by the threads owning them (chunks filled by one thread, as MPI-IO does, need zeroed_cells)
+	PGM_HOLDER allocate_chunk(const ulong rows, const ulong row_length, ChunkMemory *memory = nullptr, const bool zeroed_cells = true);
 }
 
 #endif
@@ -0,0 +1,47 @@
+#ifndef REGIONSNAPSHOTS_H
+#define REGIONSNAPSHOTS_H
+
+#include <string>
+#include <vector>
+#include <mpi.h>
+#include <PgmUtils.hpp>
+
+/*
+ * Snapshots of sub-rectangles of the grid, each with its own period. Region k is written every
+ * period steps to region<k>_<step> as a width x height PGM; only the ranks whose band intersects
+ * it take part, on a communicator of their own, through a subarray view of the file.
+ */
+class RegionSnapshots {
+public:
+	struct Region {
+		unsigned long x;
+		unsigned long y;
+		unsigned long width;
+		unsigned long height;
+		unsigned int period;
+	};
+
+	// "x,y,width,height,period"; false if malformed or not within a grid_size x grid_size grid
+	static bool parse(const std::string& text, unsigned long grid_size, Region& region);
+
+	RegionSnapshots(const std::vector<Region>& snapshot_regions, unsigned long size);
+	~RegionSnapshots();
+
+	// collective over world; to be called again whenever the band of the rank changes
+	void attach(unsigned long first_row, unsigned long rows, MPI_Comm world);
+	// collective over world; writes the regions due at step
+	void save(const PGM_HOLDER& chunk, unsigned int step) const;
+	bool due(unsigned int step) const;
+
+private:
+	void release();
+
+	std::vector<Region> regions;
+	unsigned long grid_size;
+	unsigned long band_first_row;
+	unsigned long band_rows;
+	// MPI_COMM_NULL for the regions the band of the rank does not intersect
+	std::vector<MPI_Comm> comms;
+};
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef RLEPATTERN_H
+#define RLEPATTERN_H
+
+#include <string>
+#include <PgmUtils.hpp>
+
+/*
+ * Pattern in the run length encoded format of Golly and the LifeWiki: # lines, an "x = width,
+ * y = height" line, then runs like 3o2b$ up to a "!" (b and . dead, any other letter alive, a count
+ * before $ skipping rows), placed with its top-left cell at column x and row y of the torus. Only
+ * the encoded body is kept; every rank decodes the runs of the rows of its band and skips the
+ * others, so that a sparse grid of any size is set up without an input file of that size.
+ */
+class RlePattern {
+public:
+	// path[@x,y], at (0, 0) without a placement; false if the file cannot be read or is not a pattern
+	bool load(const std::string& placement);
+
+	unsigned long width() const;
+	unsigned long height() const;
+	// sets the live cells of the pattern falling in the rows of chunk, which start at row first_row of
+	// a size x size grid, and refreshes the ghost cells of those rows
+	void place(PGM_HOLDER& chunk, unsigned long first_row, unsigned long size) const;
+
+private:
+	unsigned long x;
+	unsigned long y;
+	unsigned long columns;
+	unsigned long rows;
+	std::string body;
+};
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef ROWBALANCER_H
+#define ROWBALANCER_H
+
+#include <boost/mpi.hpp>
+#include <PgmUtils.hpp>
+
+/*
+ * Moves rows between neighboring ranks so that their compute time per step evens out. Every period
+ * steps the ranks share the compute time they accumulated, estimate a cost per row for each band
+ * and move the boundaries between consecutive ranks to where the cumulative cost is evenly split.
+ * Rows only travel between ranks r and r + 1 (rank 0 always starts at row 0, so the bands still
+ * map onto a contiguous file), and a boundary moves by at most half of the band it takes rows from.
+ * Rows only move when the slowest rank exceeds the average by more than the tolerance (at least 2%)
+ * and by more than the last move took, so that noise does not send them back and forth.
+ */
+class RowBalancer {
+public:
+	RowBalancer(unsigned int period, double tolerance);
+
+	void record(double compute_seconds);
+	// collective; updates chunk, next_chunk (unless empty) and first_row, and returns true if any band changed
+	bool rebalance(PGM_HOLDER& chunk, PGM_HOLDER& next_chunk, unsigned long& first_row, const unsigned long row_length,
+				const unsigned int step, boost::mpi::communicator world);
+
+private:
+	unsigned int period;
+	double tolerance;
+	double accumulated;
+	// the longest time a rank took to move its rows, the last time they moved
+	double migration_seconds;
+};
+
+#endif
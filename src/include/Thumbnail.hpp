@@ -0,0 +1,33 @@
+#ifndef THUMBNAIL_H
+#define THUMBNAIL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/mpi.hpp>
+#include <PgmUtils.hpp>
+
+/*
+ * Downsampled picture of the grid: pixel (y, x) is the density of live cells of the block of rows
+ * [y * grid_size / resolution, (y + 1) * grid_size / resolution) and of the columns alike, from
+ * black (empty) to white (full). Every rank counts the live cells of the pixel rows its band
+ * overlaps, and rank 0 adds the gathered counts up and writes a resolution x resolution PGM.
+ */
+class Thumbnail {
+public:
+	Thumbnail(unsigned long size, unsigned long pixels);
+
+	// collective; chunk holds the rows of the rank starting at first_row
+	void save(const std::string& filename, const PGM_HOLDER& chunk, unsigned long first_row,
+			boost::mpi::communicator world) const;
+
+private:
+	unsigned long pixel_of(unsigned long cell) const;
+
+	unsigned long grid_size;
+	unsigned long resolution;
+	// boundaries[k] is the first row (or column) of pixel row (or column) k
+	std::vector<unsigned long> boundaries;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef TILEDGRID_H
+#define TILEDGRID_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mpi.h>
+#include <PgmUtils.hpp>
+
+#define TILED_GRID_MAGIC	"GOLTILES"
+#define TILED_INDEX_MAGIC	"GOLINDEX"
+#define TILED_HEADER_LENGTH	64
+
+/*
+ * Snapshot container made of tile_size x tile_size tiles compressed independently, so that any
+ * region can be read back by fetching only the tiles it overlaps. Layout (native byte order):
+ *   header   "GOLTILES", width, height, tile_size (uint64), zero padding up to 64 bytes
+ *   tiles    row-major, each encoded as a single byte when uniform, or else as its cells packed
+ *            one bit each (row-major within the tile, least significant bit first) and deflated
+ *   index    one Entry per tile, then the offset of the index (uint64) and "GOLINDEX"
+ */
+namespace TiledGrid {
+
+	enum Codec : std::uint32_t { UNIFORM = 0, BITPACK_DEFLATE = 1 };
+
+	struct Entry {
+		std::uint64_t offset;
+		std::uint32_t length;
+		std::uint32_t codec;
+	};
+
+	struct Index {
+		std::uint64_t width;
+		std::uint64_t height;
+		std::uint64_t tile_size;
+		std::vector<Entry> tiles;
+	};
+
+	// collective; chunk holds the rows of the rank starting at first_row, in the padded layout of PgmUtils.
+	// false on every rank, with nothing written, if any tile failed to deflate
+	bool write_chunk_to_file(const std::string& filename, const PGM_HOLDER& chunk, unsigned long first_row,
+							unsigned long row_length, unsigned long tile_size, MPI_Comm comm);
+
+	// false if filename is not a tiled grid
+	bool read_index(const std::string& filename, Index& index);
+	// the width x height cells at (x, y) into region, row-major, decoding only the tiles they overlap;
+	// false if a tile cannot be read or does not inflate to its size
+	bool read_region(const std::string& filename, const Index& index, unsigned long x, unsigned long y,
+					unsigned long width, unsigned long height, std::vector<unsigned char>& region);
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstddef>
+#include <string>
+#include <mpi.h>
+
+/*
+ * Optional timeline of the phases of a run, written as Chrome trace events (chrome://tracing,
+ * Perfetto). Every thread records its spans into a ring buffer of its own, so recording takes no
+ * lock and keeps the latest events_per_thread spans. At the end the clocks of the ranks are mapped
+ * onto the clock of rank 0 (offsets measured by ping-pong when tracing starts and when it ends,
+ * interpolated in between) and rank 0 writes the spans of every rank and thread into one file.
+ */
+namespace Trace {
+
+	extern bool active;
+
+	// collective; measures the clock offsets of the ranks, then records spans
+	void start(std::size_t events_per_thread, MPI_Comm comm);
+	// name must outlive the trace (a string literal); peer is a rank, or -1
+	void record(const char *name, double begin, double end, int peer, unsigned long bytes);
+	// collective; no-op unless started
+	void write(const std::string& filename, MPI_Comm comm);
+
+	// records the span of its lifetime
+	class Span {
+	public:
+		explicit Span(const char *span_name, int span_peer = -1, unsigned long span_bytes = 0)
+			: name{span_name}, peer{span_peer}, bytes{span_bytes}, begin{active ? MPI_Wtime() : 0.0}
+		{
+		}
+		~Span()
+		{
+			if (active) {
+				record(name, begin, MPI_Wtime(), peer, bytes);
+			}
+		}
+		Span(const Span&) = delete;
+		Span& operator=(const Span&) = delete;
+
+	private:
+		const char *name;
+		int peer;
+		unsigned long bytes;
+		double begin;
+	};
+}
+
+#endif
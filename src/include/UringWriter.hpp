@@ -0,0 +1,76 @@
+#ifndef URINGWRITER_H
+#define URINGWRITER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include <linux/io_uring.h>
+#include <PgmUtils.hpp>
+
+#define DIRECT_IO_ALIGNMENT	4096
+
+/*
+ * Snapshot writer for runs within a single node. Every rank writes its part of the file through
+ * io_uring on an O_DIRECT descriptor, so snapshots bypass the page cache and leave the working set
+ * of the compute threads alone. The padded rows of a chunk are neither contiguous nor aligned enough
+ * for O_DIRECT, so the cells are packed into page-aligned staging buffers first. Several buffers are
+ * in flight at once, and a write returns as soon as its last buffer has been submitted. The blocks a
+ * rank shares with its neighbors go through buffered pwrite. So does everything else when io_uring
+ * or O_DIRECT is unavailable, or when a direct write fails.
+ */
+class UringWriter {
+public:
+	UringWriter(unsigned int depth, std::size_t staging_size);
+	~UringWriter();
+	UringWriter(const UringWriter&) = delete;
+	UringWriter& operator=(const UringWriter&) = delete;
+
+	// false when io_uring cannot be used and every write is buffered
+	bool direct() const;
+	// like PgmUtils::write_chunk_to_file, but independent: the file must exist already. These return
+	// false once a write, this one or an earlier one, has failed (and been reported on stderr)
+	bool write_chunk(const std::string& filename, const PGM_HOLDER& chunk, std::streampos start_offset,
+					unsigned long row_length);
+	// waits for every write in flight
+	bool drain();
+
+private:
+	struct File;
+	struct Staging {
+		unsigned char *data;
+		std::size_t length;
+		unsigned long long offset;
+		std::shared_ptr<File> file;
+	};
+
+	void submit(Staging& staging);
+	void complete_one();
+	// once the completions cannot be waited for: the writes in flight count as failed, their buffers are
+	// left to the kernel, and later writes are buffered
+	void abandon();
+	void release_ring();
+
+	int ring_fd;
+	unsigned int *sq_tail;
+	unsigned int *sq_mask;
+	unsigned int *sq_array;
+	unsigned int *cq_head;
+	unsigned int *cq_tail;
+	unsigned int *cq_mask;
+	io_uring_cqe *cqes;
+	io_uring_sqe *sqes;
+	void *sq_ring;
+	void *cq_ring;
+	std::size_t sq_ring_size;
+	std::size_t cq_ring_size;
+	std::size_t sqes_size;
+
+	std::size_t buffer_size;
+	std::vector<Staging> buffers;
+	std::vector<std::size_t> free_buffers;
+	unsigned int in_flight;
+	bool ok;
+};
+
+#endif
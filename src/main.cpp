@@ -1,12 +1,40 @@
+#include <algorithm>
+#include <array>
 #include <climits>
+#include <cstring>
 #include <filesystem>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <random>
 #include <sstream>
 #include <string>
 #include <argparse/argparse.hpp>
 #include <boost/mpi.hpp>
 #include <boost/mpi/timer.hpp>
+#include <boost/serialization/vector.hpp>
+#include <Affinity.hpp>
+#include <Autotune.hpp>
+#include <CacheInfo.hpp>
+#include <ChunkArena.hpp>
+#include <CycleDetector.hpp>
+#include <Ensemble.hpp>
+#include <FrameRing.hpp>
+#include <Gol.hpp>
+#include <HaloExchange.hpp>
+#include <JobServer.hpp>
+#include <LargerThanLife.hpp>
+#include <LookupTable.hpp>
+#include <MappedChunks.hpp>
+#include <MetricsFile.hpp>
 #include <PgmUtils.hpp>
+#include <RegionSnapshots.hpp>
+#include <RlePattern.hpp>
+#include <RowBalancer.hpp>
+#include <Thumbnail.hpp>
+#include <TiledGrid.hpp>
+#include <Trace.hpp>
+#include <UringWriter.hpp>
 #include <mpi.h>
 #include <omp.h>
 
@@ -20,40 +48,68 @@
 #define ONE_RANK_PRINTS(r, x) do {} while (0)
 #endif
 
-#define FIRST_ROW_OF_SENDING_RANK	1
-#define LAST_ROW_OF_SENDING_RANK	2
+// gives up on the simulation, keeping the reason for the caller of run_simulation
+#define SIMULATION_FAILS(x) \
+	do { \
+		std::ostringstream reason_; \
+		reason_ << x; \
+		error = reason_.str(); \
+		ONE_RANK_PRINTS(0, error << ". Quitting."); \
+		return EXIT_FAILURE; \
+	} while (0)
+
+#define URING_DEPTH			8
+#define URING_STAGING_SIZE	(4UL << 20)
+
+#define AUTOTUNE_SAMPLE_ROWS	1024UL
+#define AUTOTUNE_GENERATIONS	16U
 
-#define CELL_ALIVE	255
-#define CELL_DEAD	0
 #define IS_CELL_ALIVE(index) (rank_chunk[index] == CELL_ALIVE)
 
-#define SEND_LAST_ROW \
-	world.isend(next_rank, LAST_ROW_OF_SENDING_RANK, rank_chunk.data() + rank_rows * grid_size, grid_size);
-#define SEND_FIRST_ROW \
-	world.isend(prev_rank, FIRST_ROW_OF_SENDING_RANK, rank_chunk.data() + grid_size, grid_size);
-#define RECEIVE_TOP_HALO \
-	world.recv(prev_rank, LAST_ROW_OF_SENDING_RANK, rank_chunk.data(), grid_size);
-#define RECEIVE_BOTTOM_HALO \
-	world.recv(next_rank, FIRST_ROW_OF_SENDING_RANK, rank_chunk.data() + (rank_rows + 1) * grid_size, grid_size);
+#define SEND_LAST_ROW { \
+	const double exchange_start = MPI_Wtime(); \
+	Trace::Span span{"send last row", next_rank, row_stride}; \
+	world.isend(next_rank, LAST_ROW_OF_SENDING_RANK, rank_chunk.data() + rank_rows * row_stride, row_stride); \
+	exchange_seconds += MPI_Wtime() - exchange_start; }
+#define SEND_FIRST_ROW { \
+	const double exchange_start = MPI_Wtime(); \
+	Trace::Span span{"send first row", prev_rank, row_stride}; \
+	world.isend(prev_rank, FIRST_ROW_OF_SENDING_RANK, rank_chunk.data() + row_stride, row_stride); \
+	exchange_seconds += MPI_Wtime() - exchange_start; }
+#define RECEIVE_TOP_HALO { \
+	const double exchange_start = MPI_Wtime(); \
+	Trace::Span span{"receive top halo", prev_rank, row_stride}; \
+	world.recv(prev_rank, LAST_ROW_OF_SENDING_RANK, rank_chunk.data(), row_stride); \
+	exchange_seconds += MPI_Wtime() - exchange_start; }
+#define RECEIVE_BOTTOM_HALO { \
+	const double exchange_start = MPI_Wtime(); \
+	Trace::Span span{"receive bottom halo", next_rank, row_stride}; \
+	world.recv(next_rank, FIRST_ROW_OF_SENDING_RANK, rank_chunk.data() + (rank_rows + 1) * row_stride, row_stride); \
+	exchange_seconds += MPI_Wtime() - exchange_start; }
 
 namespace mpi = boost::mpi;
 namespace mt  = mpi::threading;
 
 int prev_rank, next_rank;
 ulong grid_size;
+ulong row_stride;
+ulong strip_width;
+ulong tile_size;
 uint nthreads;
-
-inline __attribute__((always_inline)) unsigned char check_left_side(PGM_HOLDER& rank_chunk, ulong index)
-{
-	return (index % grid_size == 0) ? IS_CELL_ALIVE(index - 1) + IS_CELL_ALIVE(index + grid_size - 1) + IS_CELL_ALIVE(index - 1 + 2 * grid_size)
-		: IS_CELL_ALIVE(index - grid_size - 1) + IS_CELL_ALIVE(index - 1) + IS_CELL_ALIVE(index + grid_size - 1);
-}
-
-inline __attribute__((always_inline)) unsigned char check_right_side(PGM_HOLDER& rank_chunk, ulong index)
-{
-	return ((index + 1) % grid_size == 0) ? IS_CELL_ALIVE(index + 1 - 2 * grid_size) + IS_CELL_ALIVE(index - grid_size + 1) + IS_CELL_ALIVE(index + 1)
-		: IS_CELL_ALIVE(index - grid_size + 1) + IS_CELL_ALIVE(index + 1) + IS_CELL_ALIVE(index + grid_size + 1);
-}
+uint time_block;
+uint generations = 1;
+// spent by the ordered and temporal blocking evolutions exchanging their halos themselves
+double exchange_seconds;
+ulong tile_rows;
+std::array<PGM_HOLDER, 2> blocked_bands;
+HaloExchange *halo_exchange = nullptr;
+// the library engine of evolve_static and evolve_in_place, set up by evolver_of
+std::unique_ptr<Gol::Engine> library_engine;
+UringWriter *uring_writer = nullptr;
+LargerThanLife *larger_than_life = nullptr;
+ChunkMemory *chunk_backend = nullptr;
+std::string chunk_backend_name;
+std::array<unsigned char, LOOKUP_TABLE_SIZE> block_table;
 
 void setup_parser(argparse::ArgumentParser& program)
 {
@@ -73,12 +129,25 @@ void setup_parser(argparse::ArgumentParser& program)
 
 	program.add_argument("-e")
 		.scan<'u', unsigned char>()
-		.help("evolution type (0 = ordered, 1 = static)");
+		.help("evolution type (0 = ordered, 1 = static, 2 = static with a 2x2 block lookup table, 3 = static in place, "
+			"4 = Larger than Life, 5 = static with temporal blocking); when absent, the configuration autotuned for "
+			"this machine and grid size, or 1");
+
+	program.add_argument("--autotune")
+		.help("time the static evolutions with various threads, strip widths and time blocks on a sample of the grid, "
+			"cache the fastest for this machine and grid size and use it")
+		.default_value(false)
+		.implicit_value(true);
 
 	program.add_argument("-f")
 		.default_value(std::string{"grid.pgm"})
 		.help("input file name");
 
+	program.add_argument("--pattern")
+		.append()
+		.help("file[@x,y]: with -r and -k, start from an empty grid holding this RLE pattern with its top-left cell at column x, row y "
+			"instead of reading -f (repeatable)");
+
 	program.add_argument("-n")
 		.scan<'u', unsigned int>()
 		.help("simulation steps");
@@ -86,9 +155,151 @@ void setup_parser(argparse::ArgumentParser& program)
 	program.add_argument("-s")
 		.scan<'u', unsigned int>()
 		.help("snapshotting period");
+
+	program.add_argument("--seed")
+		.scan<'u', unsigned long>()
+		.help("seed of the grid written by -i (independent of the number of ranks), or of the first universe of an ensemble");
+
+	program.add_argument("--ensemble")
+		.scan<'u', unsigned int>()
+		.default_value(0U)
+		.help("evolve this many random -k sized universes for -n steps, 64 at a time, and print their statistics");
+
+	program.add_argument("--serve")
+		.help("keep running and execute the -r jobs received, one per line, on this Unix domain socket");
+
+	program.add_argument("--io")
+		.default_value(std::string{"mpi"})
+		.help("writer of the PGM snapshots (mpi, or uring for O_DIRECT writes through io_uring when all ranks share a node)");
+
+	program.add_argument("--tiles")
+		.scan<'u', unsigned long>()
+		.default_value(0UL)
+		.help("write snapshots as containers of compressed tiles of this side, readable by region (0 = plain PGM)");
+
+	program.add_argument("--export")
+		.help("convert this tiled snapshot to the PGM named by -f");
+
+	program.add_argument("--crop")
+		.help("x,y,width,height: only export this sub-rectangle");
+
+	program.add_argument("--thumbnail")
+		.scan<'u', unsigned long>()
+		.default_value(0UL)
+		.help("side in pixels of the live-cell density thumbnails (0 = none)");
+
+	program.add_argument("--thumbnail-period")
+		.scan<'u', unsigned int>()
+		.default_value(1U)
+		.help("steps between two thumbnails");
+
+	program.add_argument("--region")
+		.append()
+		.help("x,y,width,height,period: also snapshot this sub-rectangle every period steps (repeatable)");
+
+	program.add_argument("--cycle-bound")
+		.scan<'u', unsigned int>()
+		.default_value(0U)
+		.help("stop early once the grid is periodic with at most this period (0 = never)");
+
+	program.add_argument("--cycle-check")
+		.scan<'u', unsigned int>()
+		.default_value(64U)
+		.help("steps between two global periodicity checks");
+
+	program.add_argument("--pin-threads")
+		.help("bind each OpenMP thread to its own CPU and print the resulting placement")
+		.default_value(false)
+		.implicit_value(true);
+
+	program.add_argument("--strip-width")
+		.scan<'u', unsigned long>()
+		.default_value(0UL)
+		.help("width of the column strips of the static evolution (0 = from the cache sizes)");
+
+	program.add_argument("--rebalance")
+		.scan<'u', unsigned int>()
+		.default_value(0U)
+		.help("steps between two attempts to even out the compute time of the ranks by moving rows (0 = never)");
+
+	program.add_argument("--rebalance-tolerance")
+		.scan<'g', double>()
+		.default_value(0.05)
+		.help("relative excess of the slowest rank over the average tolerated without moving rows (at least 0.02)");
+
+	program.add_argument("--halo")
+		.default_value(std::string{"p2p"})
+		.help("halo exchange of the static evolution (p2p, persistent, rma, neighbor, node-shared)");
+
+	program.add_argument("--time-block")
+		.scan<'u', unsigned int>()
+		.default_value(4U)
+		.help("generations advanced at once by the temporal blocking evolution, between the steps something observes");
+
+	program.add_argument("--radius")
+		.scan<'u', unsigned long>()
+		.default_value(1UL)
+		.help("radius of the square neighborhood of the Larger than Life evolution");
+
+	program.add_argument("--birth")
+		.default_value(std::string{"2,3"})
+		.help("min,max: live neighbors making a dead cell alive in the Larger than Life evolution");
+
+	program.add_argument("--survival")
+		.default_value(std::string{"2,3"})
+		.help("min,max: live neighbors keeping a live cell alive in the Larger than Life evolution");
+
+	program.add_argument("--frames")
+		.help("POSIX shared-memory object (e.g. /gol-frames) receiving every --frame-period generation for viewers on the node");
+
+	program.add_argument("--frame-period")
+		.scan<'u', unsigned int>()
+		.default_value(1U)
+		.help("steps between two frames of --frames");
+
+	program.add_argument("--frame-slots")
+		.scan<'u', unsigned int>()
+		.default_value(8U)
+		.help("frames kept in the --frames ring before the oldest is overwritten");
+
+	program.add_argument("--frame-scale")
+		.scan<'u', unsigned int>()
+		.default_value(1U)
+		.help("one cell out of this many in both directions goes to the --frames frames");
+
+	program.add_argument("--frame-bits")
+		.help("bit-pack the --frames frames, eight cells per byte")
+		.default_value(false)
+		.implicit_value(true);
+
+	program.add_argument("--metrics")
+		.help("Prometheus textfile rewritten with the progress of the run about every --metrics-interval seconds");
+
+	program.add_argument("--metrics-interval")
+		.scan<'g', double>()
+		.default_value(15.0)
+		.help("seconds between two rewrites of the --metrics file");
+
+	program.add_argument("--trace")
+		.help("Chrome trace-event JSON file written at exit with the timeline of the phases of every rank and thread");
+
+	program.add_argument("--trace-events")
+		.scan<'u', unsigned long>()
+		.default_value(65536UL)
+		.help("spans kept per thread for --trace, the latest ones once exceeded");
+
+	program.add_argument("--memory")
+		.default_value(std::string{"heap"})
+		.help("memory of the chunks (heap, thp for madvised transparent huge pages, hugetlb for hugetlbfs pages); "
+			"a server keeps the one of its command line");
+
+	program.add_argument("--arena")
+		.help("keep freed chunks for reuse by the next chunks of the same size")
+		.default_value(false)
+		.implicit_value(true);
 }
 
-std::string compute_checkpoint_filename(unsigned long step)
+std::string compute_checkpoint_filename(unsigned long step, const std::string& prefix = "snapshot_")
 {
 	std::string suffix{};
 	if (step < 10) {
@@ -102,76 +313,204 @@ std::string compute_checkpoint_filename(unsigned long step)
 	} else {
 		suffix = std::to_string(step);
 	}
-	return "snapshot_" + suffix;
+	return prefix + suffix;
 }
 
 std::pair<ulong, ulong> compute_rank_chunk_bounds(mpi::communicator world)
 {
-	if (world.size() == 1) {
-		return { grid_size, 0 };
-	}
-	const auto base_rows_per_rank = grid_size / world.size();
-	auto rank_rows = base_rows_per_rank;
-	const auto leftovers = grid_size % world.size();
-	if (ulong(world.rank()) < leftovers)
-		rank_rows++;
-	auto rank_offset = 0UL;
-	for (auto i = 0; i < world.rank(); i++) {
-		bool correction_factor = ulong(i) < leftovers;
-		rank_offset += (base_rows_per_rank + correction_factor) * grid_size;
-	}
-	return { rank_rows, rank_offset };
+	const auto [rank_rows, first_row] = Gol::band_of(grid_size, static_cast<MPI_Comm>(world));
+	return { rank_rows, first_row * grid_size };
 }
 
 inline __attribute__((always_inline)) char count_alive_neighbors(PGM_HOLDER& rank_chunk, ulong j)
 {
-	return check_left_side(rank_chunk, j) + check_right_side(rank_chunk, j) + IS_CELL_ALIVE(j + grid_size) + IS_CELL_ALIVE(j - grid_size);
+	return IS_CELL_ALIVE(j - row_stride - 1) + IS_CELL_ALIVE(j - row_stride) + IS_CELL_ALIVE(j - row_stride + 1)
+		+ IS_CELL_ALIVE(j - 1) + IS_CELL_ALIVE(j + 1)
+		+ IS_CELL_ALIVE(j + row_stride - 1) + IS_CELL_ALIVE(j + row_stride) + IS_CELL_ALIVE(j + row_stride + 1);
 }
 
-void evolve_static(PGM_HOLDER& rank_chunk, PGM_HOLDER& next_step_chunk, mpi::communicator world)
+// the static evolutions of libgol, between the halo exchanges of gol
+static void evolve_with_engine(PGM_HOLDER& rank_chunk, PGM_HOLDER& next_step_chunk)
 {
-	const ulong rank_rows = (rank_chunk.size() / grid_size) - 2; // minus 2 halo rows
-	if (world.size() != 1) {
-		if (world.rank()) {
-			SEND_FIRST_ROW;
-			SEND_LAST_ROW;
-			RECEIVE_TOP_HALO;
-			RECEIVE_BOTTOM_HALO;
-		} else {
-			RECEIVE_TOP_HALO;
-			RECEIVE_BOTTOM_HALO;
-			SEND_FIRST_ROW;
-			SEND_LAST_ROW;
+	if (halo_exchange) {
+		halo_exchange->exchange(rank_chunk);
+	}
+	library_engine->evolve_chunk(rank_chunk, next_step_chunk, grid_size);
+	if (halo_exchange) {
+		halo_exchange->publish();
+	}
+}
+
+void evolve_static(PGM_HOLDER& rank_chunk, PGM_HOLDER& next_step_chunk, mpi::communicator)
+{
+	evolve_with_engine(rank_chunk, next_step_chunk);
+}
+
+void evolve_in_place(PGM_HOLDER& rank_chunk, PGM_HOLDER& next_step_chunk, mpi::communicator)
+{
+	evolve_with_engine(rank_chunk, next_step_chunk);
+}
+
+// one generation of the rows [first, last) of the blocked band, from bands[source] to the other band
+static void evolve_blocked_rows(unsigned char *const bands[2], const int source, const long first, const long last)
+{
+	for (auto row = first; row < last; row++) {
+		const unsigned char *mid = bands[source] + (row + 1) * row_stride;
+		unsigned char *next = bands[1 - source] + (row + 1) * row_stride;
+		Gol::evolve_cells(mid - row_stride, mid, mid + row_stride, next, 1, grid_size + 1);
+		PgmUtils::refresh_ghost_cells(next, grid_size);
+	}
+}
+
+/*
+ * Same results as evolve_static, generations steps at a time. The band is cut into tiles of
+ * tile_rows rows, advanced through all the generations while they are in cache: first trapezoids,
+ * losing a row per generation on either side, then, once the two trapezoids around a boundary
+ * are done, the inverted trapezoid filling the gap between them, gaining a row per generation.
+ * Generations alternate between the two bands, whose rows written by one tile never hold a
+ * generation still needed by another. On several ranks the band is extended by generations rows
+ * of the neighbors, recomputed locally so that one exchange covers all the generations; a single
+ * rank has no vertical wraparound, so its halo rows stay dead and the outermost tiles do not shrink.
+ */
+void evolve_blocked(PGM_HOLDER& rank_chunk, PGM_HOLDER& next_step_chunk, mpi::communicator world)
+{
+	const long rank_rows = long(rank_chunk.size() / row_stride) - 2;
+	const long depth = world.size() != 1 ? long(generations) : 0;
+	unsigned char *bands[2] = { rank_chunk.data(), next_step_chunk.data() };
+	if (depth) {
+		for (auto& band : blocked_bands) {
+			if (band.size() != (rank_rows + 2 * time_block + 2) * row_stride) {
+				band = PgmUtils::allocate_chunk(rank_rows + 2 * time_block, grid_size, nullptr, false);
+			}
 		}
+		bands[0] = blocked_bands[0].data();
+		bands[1] = blocked_bands[1].data();
+		const double exchange_start = MPI_Wtime();
+		const int length = int(depth * row_stride);
+		Trace::Span span{"deep halo exchange", -1, 2UL * ulong(length)};
+		const MPI_Comm comm = static_cast<MPI_Comm>(world);
+		MPI_Request requests[4];
+		MPI_Irecv(bands[0] + row_stride, length, MPI_UNSIGNED_CHAR, prev_rank, LAST_ROW_OF_SENDING_RANK, comm, &requests[0]);
+		MPI_Irecv(bands[0] + (depth + rank_rows + 1) * row_stride, length, MPI_UNSIGNED_CHAR, next_rank,
+				FIRST_ROW_OF_SENDING_RANK, comm, &requests[1]);
+		MPI_Isend(rank_chunk.data() + row_stride, length, MPI_UNSIGNED_CHAR, prev_rank, FIRST_ROW_OF_SENDING_RANK, comm, &requests[2]);
+		MPI_Isend(rank_chunk.data() + (rank_rows + 1 - depth) * row_stride, length, MPI_UNSIGNED_CHAR, next_rank,
+				LAST_ROW_OF_SENDING_RANK, comm, &requests[3]);
+		std::memcpy(bands[0] + (depth + 1) * row_stride, rank_chunk.data() + row_stride, rank_rows * row_stride);
+		MPI_Waitall(4, requests, MPI_STATUSES_IGNORE);
+		exchange_seconds += MPI_Wtime() - exchange_start;
 	}
-	const auto start = grid_size, end = (rank_rows + 1) * grid_size;
-	const auto elements = end - start;
-	const ulong elements_per_thread = elements / nthreads;
-#pragma omp taskloop shared(rank_chunk, next_step_chunk) grainsize(1)
-	for (auto j = start; j < nthreads * elements_per_thread; j += elements_per_thread) {
-		auto i = j;
-		for (; i < j + elements_per_thread; i += 4) {
-			const auto next_1 = i+1, next_2 = i+2, next_3 = i+3;
-			char alive_neighbors = count_alive_neighbors(rank_chunk, i);
-			char alive_neighbors_1 = count_alive_neighbors(rank_chunk, next_1);
-			char alive_neighbors_2 = count_alive_neighbors(rank_chunk, next_2);
-			char alive_neighbors_3 = count_alive_neighbors(rank_chunk, next_3);
-			next_step_chunk[i] = (alive_neighbors == 3 || alive_neighbors == 2) ? CELL_ALIVE : CELL_DEAD;
-			next_step_chunk[next_1] = (alive_neighbors_1 == 3 || alive_neighbors_1 == 2) ? CELL_ALIVE : CELL_DEAD;
-			next_step_chunk[next_2] = (alive_neighbors_2 == 3 || alive_neighbors_2 == 2) ? CELL_ALIVE : CELL_DEAD;
-			next_step_chunk[next_3] = (alive_neighbors_3 == 3 || alive_neighbors_3 == 2) ? CELL_ALIVE : CELL_DEAD;
-		}
-		if (i != j + elements_per_thread) {
-			i = i - 4 + 1;
-			for (; i < j + elements_per_thread; i++) {
-				char alive_neighbors = count_alive_neighbors(rank_chunk, i);
-				next_step_chunk[i] = (alive_neighbors == 3 || alive_neighbors == 2) ? CELL_ALIVE : CELL_DEAD;
+	const long rows = rank_rows + 2 * depth;
+	const long tiles = std::max(rows / long(tile_rows), 1L);
+	const auto boundary = [rows, tiles](long k) { return long(PgmUtils::thread_slice(rows, uint(k), uint(tiles)).first); };
+	std::vector<char> tile_done(tiles);
+#pragma omp parallel num_threads(nthreads)
+#pragma omp single
+	{
+		for (long k = 0; k < tiles; k++) {
+#pragma omp task depend(out: tile_done.data()[k])
+			{
+				Trace::Span span{"trapezoid"};
+				const auto first = boundary(k), last = k == tiles - 1 ? rows : boundary(k + 1);
+				for (long g = 1; g <= long(generations); g++) {
+					evolve_blocked_rows(bands, int((g - 1) % 2), first + (k || depth ? g : 0), last - (k < tiles - 1 || depth ? g : 0));
+				}
+			}
+		}
+		for (long k = 1; k < tiles; k++) {
+#pragma omp task depend(in: tile_done.data()[k - 1], tile_done.data()[k])
+			{
+				Trace::Span span{"inverted trapezoid"};
+				const auto middle = boundary(k);
+				for (long g = 1; g <= long(generations); g++) {
+					evolve_blocked_rows(bands, int((g - 1) % 2), middle - g, middle + g);
+				}
 			}
 		}
 	}
-	for (auto i = start + nthreads * elements_per_thread; i < end; i++) {
-		char alive_neighbors = count_alive_neighbors(rank_chunk, i);
-		next_step_chunk[i] = (alive_neighbors == 3 || alive_neighbors == 2) ? CELL_ALIVE : CELL_DEAD;
+	// the caller swaps the chunks afterwards, so the result goes to next_step_chunk
+	if (depth) {
+		std::memcpy(next_step_chunk.data() + row_stride, bands[generations % 2] + (depth + 1) * row_stride, rank_rows * row_stride);
+	} else if (generations % 2 == 0) {
+		rank_chunk.swap(next_step_chunk);
+	}
+}
+
+void evolve_larger_than_life(PGM_HOLDER& rank_chunk, PGM_HOLDER& next_step_chunk, mpi::communicator)
+{
+	larger_than_life->evolve(rank_chunk, next_step_chunk);
+}
+
+// the rule of every engine: alive with 2 or 3 live neighbors, whatever the current state
+bool next_state(bool, unsigned int alive_neighbors)
+{
+	return alive_neighbors == 3 || alive_neighbors == 2;
+}
+
+// bytes of a pair of cells from two bits of a block_table entry
+inline __attribute__((always_inline)) void store_pair(unsigned char *cells, unsigned int bits)
+{
+	static constexpr unsigned char pairs[4][2] = { { CELL_DEAD, CELL_DEAD }, { CELL_ALIVE, CELL_DEAD },
+		{ CELL_DEAD, CELL_ALIVE }, { CELL_ALIVE, CELL_ALIVE } };
+	std::memcpy(cells, pairs[bits & 3], 2);
+}
+
+void evolve_lookup(PGM_HOLDER& rank_chunk, PGM_HOLDER& next_step_chunk, mpi::communicator)
+{
+	const ulong rank_rows = (rank_chunk.size() / row_stride) - 2;
+	const ulong packed_length = LookupTable::packed_length(grid_size + 2);
+	if (halo_exchange) {
+		halo_exchange->exchange(rank_chunk);
+	}
+#pragma omp parallel for schedule(static) shared(rank_chunk, next_step_chunk)
+	for (uint t = 0; t < nthreads; t++) {
+		Trace::Span span{"rows"};
+		const auto [row_begin, row_end] = PgmUtils::thread_slice(rank_rows, t, nthreads);
+		// the four packed rows around the pair of rows being computed, the last two reused by the next pair
+		std::vector<unsigned char> packed(4 * packed_length, 0);
+		std::array<unsigned char*, 4> window{ packed.data(), packed.data() + packed_length,
+			packed.data() + 2 * packed_length, packed.data() + 3 * packed_length };
+		for (auto row = row_begin + 1; row < row_end + 1; row += 2) {
+			const bool pair = row + 1 < row_end + 1;
+			if (row == row_begin + 1) {
+				LookupTable::pack_row(rank_chunk.data() + (row - 1) * row_stride, grid_size + 2, window[0]);
+				LookupTable::pack_row(rank_chunk.data() + row * row_stride, grid_size + 2, window[1]);
+			} else {
+				std::swap(window[0], window[2]);
+				std::swap(window[1], window[3]);
+			}
+			LookupTable::pack_row(rank_chunk.data() + (row + 1) * row_stride, grid_size + 2, window[2]);
+			if (pair) {
+				LookupTable::pack_row(rank_chunk.data() + (row + 2) * row_stride, grid_size + 2, window[3]);
+			}
+			unsigned char *upper = next_step_chunk.data() + row * row_stride;
+			unsigned char *lower = upper + row_stride;
+			// 28 pairs of columns per load of the packed rows; an odd last column also writes the right
+			// ghost cell, which is refreshed below
+			for (ulong first = 1; first <= grid_size; first += 56) {
+				std::array<std::uint64_t, 4> words;
+				for (uint r = 0; r < 4; r++) {
+					std::memcpy(&words[r], window[r] + (first - 1) / 8, sizeof(std::uint64_t));
+				}
+				const ulong end = std::min(first + 56, grid_size + 1);
+				for (ulong c = first; c < end; c += 2) {
+					const auto shift = c - first;
+					const unsigned int block = block_table[((words[0] >> shift) & 0xF) | ((words[1] >> shift) & 0xF) << 4
+						| ((words[2] >> shift) & 0xF) << 8 | ((words[3] >> shift) & 0xF) << 12];
+					store_pair(upper + c, block);
+					if (pair) {
+						store_pair(lower + c, block >> 2);
+					}
+				}
+			}
+			PgmUtils::refresh_ghost_cells(upper, grid_size);
+			if (pair) {
+				PgmUtils::refresh_ghost_cells(lower, grid_size);
+			}
+		}
+	}
+	if (halo_exchange) {
+		halo_exchange->publish();
 	}
 }
 
@@ -181,16 +520,28 @@ inline __attribute__((always_inline)) void update_cell_ordered(PGM_HOLDER& rank_
 	rank_chunk[j] = (alive_neighbors == 3 || alive_neighbors == 2) ? CELL_ALIVE : CELL_DEAD;
 }
 
+// the ghost cells follow their cell right away, so that the update order matches the one of a wrapping grid
+inline void update_rows_ordered(PGM_HOLDER& rank_chunk, ulong rank_rows)
+{
+	for (auto row = 1UL; row <= rank_rows; row++) {
+		const auto first = row * row_stride + 1, last = row * row_stride + grid_size;
+		update_cell_ordered(rank_chunk, first);
+		rank_chunk[last + 1] = rank_chunk[first];
+		for (auto j = first + 1; j <= last; j++) {
+			update_cell_ordered(rank_chunk, j);
+		}
+		rank_chunk[first - 1] = rank_chunk[last];
+	}
+}
+
 void evolve_ordered(PGM_HOLDER& rank_chunk, PGM_HOLDER& unused, mpi::communicator world)
 {
-	const ulong rank_rows = (rank_chunk.size() / grid_size) - 2;
+	const ulong rank_rows = (rank_chunk.size() / row_stride) - 2;
 	if (world.size() != 1) {
 		if (world.rank() == 0) {
 			RECEIVE_TOP_HALO;
 			RECEIVE_BOTTOM_HALO;
-			for (auto j = grid_size; j < (rank_rows + 1) * grid_size ; j++) {
-				update_cell_ordered(rank_chunk, j);
-			}
+			update_rows_ordered(rank_chunk, rank_rows);
 			SEND_FIRST_ROW;
 			SEND_LAST_ROW;
 		} else if (world.rank() == world.size() - 1) {
@@ -198,33 +549,498 @@ void evolve_ordered(PGM_HOLDER& rank_chunk, PGM_HOLDER& unused, mpi::communicato
 			SEND_FIRST_ROW;
 			RECEIVE_BOTTOM_HALO;
 			RECEIVE_TOP_HALO;
-			for (auto j = grid_size; j < (rank_rows + 1) * grid_size ; j++) {
-				update_cell_ordered(rank_chunk, j);
-			}
+			update_rows_ordered(rank_chunk, rank_rows);
 		} else {
 			SEND_FIRST_ROW;
 			RECEIVE_BOTTOM_HALO;
 			RECEIVE_TOP_HALO;
-			for (auto j = grid_size; j < (rank_rows + 1) * grid_size ; j++) {
-				update_cell_ordered(rank_chunk, j);
-			}
+			update_rows_ordered(rank_chunk, rank_rows);
 			SEND_LAST_ROW;
 		}
 	} else {
-		for (auto j = grid_size; j < (rank_rows + 1) * grid_size ; j++) {
-			update_cell_ordered(rank_chunk, j);
+		update_rows_ordered(rank_chunk, rank_rows);
+	}
+}
+
+// nullptr for an unknown evolution type; sets up what the evolution needs for the current configuration
+auto evolver_of(unsigned int evolution_type) -> void (*)(PGM_HOLDER&, PGM_HOLDER&, mpi::communicator)
+{
+	if (evolution_type == 1) {
+		library_engine = Gol::Engine::create("static", nthreads, strip_width);
+		return evolve_static;
+	} else if (evolution_type == 0) {
+		return evolve_ordered;
+	} else if (evolution_type == 2) {
+		block_table = LookupTable::build(next_state);
+		return evolve_lookup;
+	} else if (evolution_type == 3) {
+		library_engine = Gol::Engine::create("in-place", nthreads);
+		return evolve_in_place;
+	} else if (evolution_type == 4) {
+		return evolve_larger_than_life;
+	} else if (evolution_type == 5) {
+		return evolve_blocked;
+	}
+	return nullptr;
+}
+
+// never more threads than thread_budget, the threads the process started with
+void apply_configuration(const Autotune::Configuration& configuration, uint thread_budget)
+{
+	nthreads = std::max(std::min(configuration.threads, thread_budget), 1U);
+	omp_set_num_threads(int(nthreads));
+	strip_width = configuration.strip_width;
+	if (configuration.time_block) {
+		time_block = configuration.time_block;
+	}
+	tile_rows = CacheInfo::tile_rows(row_stride, time_block);
+}
+
+/*
+ * Configuration of the static evolutions for this machine and grid size: the cached one, unless
+ * retuning, in which case every candidate evolves a sample of the band of each rank on its own
+ * (first one generation to warm up, then AUTOTUNE_GENERATIONS timed ones) and the candidate with
+ * the lowest time of its slowest rank is cached. Collective; false if nothing is cached.
+ */
+bool tuned_configuration(bool retune, bool fixed_bands, const std::function<void(PGM_HOLDER&)>& load_rows, ulong rank_rows,
+						mpi::communicator world, Autotune::Configuration& best)
+{
+	const auto path = Autotune::cache_path();
+	// nthreads is still the thread budget of the process here
+	const uint thread_budget = nthreads;
+	const auto key = Autotune::machine_key(grid_size, world.size(), thread_budget);
+	int cached = 0;
+	if (!world.rank()) {
+		cached = !retune && Autotune::lookup(path, key, best);
+	}
+	broadcast(world, cached, 0);
+	if (cached) {
+		MPI_Bcast(&best, sizeof(best), MPI_BYTE, 0, static_cast<MPI_Comm>(world));
+		return true;
+	}
+	if (!retune) {
+		return false;
+	}
+
+	PGM_HOLDER sample = PgmUtils::allocate_chunk(std::min(rank_rows, AUTOTUNE_SAMPLE_ROWS), grid_size, nullptr, false);
+	load_rows(sample);
+	const auto thinnest_band = mpi::all_reduce(world, rank_rows, mpi::minimum<ulong>());
+	mpi::communicator self{MPI_COMM_SELF, mpi::comm_attach};
+	auto candidates = Autotune::candidates(nthreads, CacheInfo::strip_width(grid_size), grid_size);
+	// the temporal blocking evolution needs fixed bands at least time_block rows tall
+	candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](const Autotune::Configuration& candidate) {
+		return candidate.engine == 5 && (!fixed_bands || (world.size() != 1 && candidate.time_block > thinnest_band));
+	}), candidates.end());
+	for (auto& candidate : candidates) {
+		apply_configuration(candidate, thread_budget);
+		const auto evolver = evolver_of(candidate.engine);
+		generations = candidate.engine == 5 ? candidate.time_block : 1;
+		PGM_HOLDER current = sample;
+		PGM_HOLDER next = PgmUtils::allocate_chunk(sample.size() / row_stride - 2, grid_size, nullptr, false);
+		double start = 0;
+		for (uint done = 0; done < AUTOTUNE_GENERATIONS + generations; done += generations) {
+			if (done == generations) {
+				start = MPI_Wtime();
+			}
+			evolver(current, next, self);
+			if (evolver != evolve_in_place) {
+				current.swap(next);
+			}
 		}
+		candidate.seconds = mpi::all_reduce(world, MPI_Wtime() - start, mpi::maximum<double>());
+	}
+	generations = 1;
+	best = *std::min_element(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+		return a.seconds < b.seconds;
+	});
+	if (!world.rank() && !Autotune::store(path, key, best)) {
+		ONE_RANK_PRINTS(0, "Cannot write " << path);
 	}
+	return true;
 }
 
-void save_snapshot(PGM_HOLDER& rank_chunk, int i, std::streampos rank_file_offset_streampos, mpi::communicator world)
+// adds the cells written by the rank to bytes_written; collective, false on every rank if any failed to write
+bool save_snapshot(PGM_HOLDER& rank_chunk, int i, std::streampos rank_file_offset_streampos, ulong first_row, mpi::communicator world,
+				double& bytes_written)
 {
 	const auto checkpoint_filename = compute_checkpoint_filename(i);
+	const ulong cells = (rank_chunk.size() / row_stride - 2) * grid_size;
+	Trace::Span span{"snapshot", -1, cells};
+	bytes_written += double(cells);
+	if (tile_size) {
+		return TiledGrid::write_chunk_to_file(checkpoint_filename + ".tiles", rank_chunk, first_row, grid_size, tile_size,
+											static_cast<MPI_Comm>(world));
+	}
 	if (!world.rank()) {
 		const SIZE_HOLDER dimensions{grid_size, grid_size};
 		PgmUtils::write_header(checkpoint_filename, dimensions);
 	}
+	if (uring_writer) {
+		world.barrier();
+		const bool written = uring_writer->write_chunk(checkpoint_filename, rank_chunk, rank_file_offset_streampos, grid_size);
+		return mpi::all_reduce(world, int(written), mpi::minimum<int>());
+	}
 	PgmUtils::write_chunk_to_file(checkpoint_filename, rank_chunk, rank_file_offset_streampos, grid_size, static_cast<MPI_Comm>(world));
+	return true;
+}
+
+// runs the simulation described by the -r options of program, reusing rank_chunk and next_step_chunk
+// when possible, and writes its timing CSV line to csv on rank 0; on failure, error tells why
+int run_simulation(argparse::ArgumentParser& program, mpi::communicator world, PGM_HOLDER& rank_chunk,
+				PGM_HOLDER& next_step_chunk, std::ostream& csv, std::string& error)
+{
+	const auto filename = program.get<std::string>("-f");
+	const auto ranks = world.size();
+	uint header_length;
+
+	std::vector<RlePattern> patterns;
+	for (const auto& placement : program.present<std::vector<std::string>>("--pattern").value_or(std::vector<std::string>{})) {
+		patterns.emplace_back();
+		if (!patterns.back().load(placement)) {
+			SIMULATION_FAILS("Cannot read pattern " << placement);
+		}
+	}
+
+	// Rank 0 reads the header, unless the grid is made of patterns and the snapshots get the header of write_header
+	grid_size = 0;
+	if (!patterns.empty()) {
+		grid_size = program.present<unsigned long>("-k").value_or(0);
+		const auto size = std::to_string(grid_size);
+		header_length = uint(("P5 " + size + " " + size + " " + std::to_string(PGM_MAX_VALUE) + "\n").size());
+	} else if (!world.rank()) {
+		std::ifstream infile(filename.c_str());
+		std::string line;
+		std::getline(infile, line);
+		std::istringstream iss(line);
+		header_length = uint(line.size()) + 1; // account for new line
+		std::string magic;
+		iss >> magic >> grid_size;
+	}
+
+	if (ranks != 1) {
+		broadcast(world, grid_size, 0);
+		broadcast(world, header_length, 0);
+		prev_rank = world.rank() - 1 >= 0 ? world.rank() - 1 : world.size() - 1;
+		next_rank = world.rank() + 1 >= world.size() ? 0 : world.rank() + 1;
+	}
+	if (!grid_size) {
+		SIMULATION_FAILS("Cannot read " << filename);
+	}
+	for (const auto& pattern : patterns) {
+		if (pattern.width() > grid_size || pattern.height() > grid_size) {
+			SIMULATION_FAILS("A " << pattern.width() << "x" << pattern.height() << " pattern does not fit the grid");
+		}
+	}
+
+	const auto simulation_steps = program.get<unsigned int>("-n");
+	const auto snapshotting_period = program.get<unsigned int>("-s");
+	const auto cycle_bound = program.get<unsigned int>("--cycle-bound");
+	const auto cycle_check = program.get<unsigned int>("--cycle-check");
+
+	// the threads of the process, of which a tuned configuration may use fewer for its run
+	static const uint available_threads = omp_get_max_threads();
+	nthreads = available_threads;
+	omp_set_num_threads(int(nthreads));
+	row_stride = PgmUtils::row_stride(grid_size);
+	tile_size = program.get<unsigned long>("--tiles");
+	strip_width = program.get<unsigned long>("--strip-width");
+	strip_width = strip_width ? std::min(strip_width, grid_size) : CacheInfo::strip_width(grid_size);
+	time_block = program.get<unsigned int>("--time-block");
+	tile_rows = CacheInfo::tile_rows(row_stride, time_block);
+	auto [rank_rows, rank_offset] = compute_rank_chunk_bounds(world);
+	auto rank_file_offset = rank_offset + header_length;
+	std::streampos rank_file_offset_streampos = static_cast<std::streampos>(rank_file_offset);
+
+	// fills the rows of chunk with the first rows of the band of the rank
+	const auto load_rows = [&](PGM_HOLDER& chunk) {
+		if (patterns.empty()) {
+			PgmUtils::read_chunk_from_file(filename, chunk, grid_size, rank_file_offset_streampos, static_cast<MPI_Comm>(world));
+			return;
+		}
+		const long rows = long(chunk.size() / row_stride) - 2;
+#pragma omp parallel for schedule(static)
+		for (long row = 1; row <= rows; row++) {
+			std::memset(chunk.data() + row * row_stride, CELL_DEAD, row_stride);
+		}
+		for (const auto& pattern : patterns) {
+			pattern.place(chunk, rank_offset / grid_size, grid_size);
+		}
+	};
+
+	unsigned int evolution_type = program.present<unsigned char>("-e").value_or(1);
+	if (program["--autotune"] == true || !program.present<unsigned char>("-e")) {
+		const bool fixed_bands = !program.get<unsigned int>("--rebalance");
+		Autotune::Configuration tuned;
+		if (tuned_configuration(program["--autotune"] == true, fixed_bands, load_rows, rank_rows, world, tuned)
+			&& (tuned.engine != 5 || fixed_bands)) {
+			evolution_type = tuned.engine;
+			apply_configuration(tuned, available_threads);
+			ONE_RANK_PRINTS(0, "Tuned: -e " << evolution_type << ", " << nthreads << " threads, strip width " << strip_width
+				<< ", time block " << time_block);
+		}
+	}
+	const auto evolver = evolver_of(evolution_type);
+	if (!evolver) {
+		SIMULATION_FAILS("Unknown evolution type");
+	}
+	// engines writing the next generation over the current one, which need no next_step_chunk
+	const bool in_place = evolver == evolve_ordered || evolver == evolve_in_place;
+
+	if (program["--pin-threads"] == true) {
+		Affinity::pin_threads();
+		Affinity::report(world);
+	}
+
+	std::vector<RegionSnapshots::Region> regions;
+	for (const auto& text : program.present<std::vector<std::string>>("--region").value_or(std::vector<std::string>{})) {
+		regions.emplace_back();
+		if (!RegionSnapshots::parse(text, grid_size, regions.back())) {
+			SIMULATION_FAILS("Invalid region " << text);
+		}
+	}
+
+	std::unique_ptr<LargerThanLife> range_automaton;
+	if (evolver == evolve_larger_than_life) {
+		LargerThanLife::Rule rule;
+		rule.radius = program.get<unsigned long>("--radius");
+		if (!LargerThanLife::parse_interval(program.get<std::string>("--birth"), rule.birth_min, rule.birth_max)
+			|| !LargerThanLife::parse_interval(program.get<std::string>("--survival"), rule.survival_min, rule.survival_max)) {
+			SIMULATION_FAILS("Invalid birth or survival interval");
+		}
+		// the neighbors of a cell must be distinct cells, and come from the adjacent bands only
+		const auto thinnest_band = mpi::all_reduce(world, rank_rows, mpi::minimum<ulong>());
+		if (!rule.radius || 2 * rule.radius + 1 > grid_size || (ranks != 1 && thinnest_band < rule.radius)) {
+			SIMULATION_FAILS("Radius " << rule.radius << " does not fit the grid or the bands");
+		}
+		if (program.get<unsigned int>("--rebalance")) {
+			SIMULATION_FAILS("The Larger than Life evolution keeps the bands fixed");
+		}
+		range_automaton = std::make_unique<LargerThanLife>(rule, grid_size, static_cast<MPI_Comm>(world), prev_rank, next_rank);
+	}
+	larger_than_life = range_automaton.get();
+	if (evolver == evolve_blocked) {
+		// the extended bands only take rows of the adjacent bands
+		const auto thinnest_band = mpi::all_reduce(world, rank_rows, mpi::minimum<ulong>());
+		if (!time_block || (ranks != 1 && thinnest_band < time_block)) {
+			SIMULATION_FAILS("Blocks of " << time_block << " generations do not fit the bands");
+		}
+		if (program.get<unsigned int>("--rebalance")) {
+			SIMULATION_FAILS("The temporal blocking evolution keeps the bands fixed");
+		}
+	}
+	ulong first_row = rank_offset / grid_size;
+	mpi::timer timer;
+	std::unique_ptr<HaloExchange> halo;
+	if (ranks != 1) {
+		halo = HaloExchange::create(program.get<std::string>("--halo"), static_cast<MPI_Comm>(world), prev_rank, next_rank, row_stride);
+		if (!halo) {
+			SIMULATION_FAILS("Unknown halo exchange");
+		}
+		if (evolver == evolve_in_place && halo->memory()) {
+			// neighbors would read our rows while we overwrite them
+			SIMULATION_FAILS("The " << halo->name() << " halo exchange needs a double-buffered engine");
+		}
+	}
+	std::unique_ptr<UringWriter> uring;
+	const auto io = program.get<std::string>("--io");
+	if (io == "uring") {
+		MPI_Comm node_comm;
+		int node_ranks;
+		MPI_Comm_split_type(static_cast<MPI_Comm>(world), MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node_comm);
+		MPI_Comm_size(node_comm, &node_ranks);
+		MPI_Comm_free(&node_comm);
+		if (node_ranks == ranks) {
+			uring = std::make_unique<UringWriter>(URING_DEPTH, URING_STAGING_SIZE);
+			if (!uring->direct()) {
+				ONE_RANK_PRINTS(0, "io_uring unavailable, snapshots use buffered writes.");
+			}
+		} else {
+			ONE_RANK_PRINTS(0, "Ranks span several nodes, snapshots use MPI-IO.");
+		}
+	} else if (io != "mpi") {
+		SIMULATION_FAILS("Unknown snapshot writer");
+	}
+	std::unique_ptr<FrameRing> frame_ring;
+	const auto frame_period = program.present("--frames") ? program.get<unsigned int>("--frame-period") : 0U;
+	if (frame_period) {
+		frame_ring = std::make_unique<FrameRing>(*program.present("--frames"), grid_size, program.get<unsigned int>("--frame-slots"),
+												program.get<unsigned int>("--frame-scale"), program["--frame-bits"] == true,
+												static_cast<MPI_Comm>(world));
+		if (!frame_ring->ready()) {
+			SIMULATION_FAILS("Cannot share frames on this node through " << *program.present("--frames"));
+		}
+	}
+	uring_writer = uring.get();
+	ChunkMemory *halo_memory = halo ? halo->memory() : nullptr;
+	ChunkMemory *chunk_memory = halo_memory ? halo_memory : chunk_backend;
+	// the buffers of the previous run are reused when they have the right size and live in the same memory,
+	// unless that memory belongs to the halo exchange; both are about to be overwritten, next_step_chunk by the engines
+	const auto reusable = [&](const PGM_HOLDER& chunk) {
+		return !halo_memory && chunk.size() == (rank_rows + 2) * row_stride && chunk.get_allocator().backing() == chunk_memory;
+	};
+	if (!reusable(rank_chunk)) {
+		rank_chunk = PgmUtils::allocate_chunk(rank_rows, grid_size, chunk_memory);
+	}
+	if (in_place) {
+		PGM_HOLDER{}.swap(next_step_chunk);
+	} else if (!reusable(next_step_chunk)) {
+		next_step_chunk = PgmUtils::allocate_chunk(rank_rows, grid_size, chunk_memory, false);
+	}
+	// seconds spent loading the grid and writing snapshots, regions, thumbnails and frames
+	double read_seconds = MPI_Wtime(), write_seconds = 0;
+	{
+		Trace::Span span{"read grid", -1, rank_rows * grid_size};
+		load_rows(rank_chunk);
+	}
+	read_seconds = MPI_Wtime() - read_seconds;
+	if (halo) {
+		halo->attach(rank_chunk, next_step_chunk);
+	}
+	// the ordered, Larger than Life and temporal blocking evolutions exchange their halos themselves
+	halo_exchange = evolver != evolve_ordered && evolver != evolve_larger_than_life && evolver != evolve_blocked ? halo.get() : nullptr;
+	exchange_seconds = 0;
+	// spent exchanging halos so far, by whichever does it for the engine
+	const auto communication_seconds = [] {
+		return halo_exchange ? halo_exchange->seconds() : larger_than_life ? larger_than_life->seconds() : exchange_seconds;
+	};
+	CycleDetector cycle_detector{cycle_bound, cycle_check};
+	const auto thumbnail_period = program.get<unsigned long>("--thumbnail") ? program.get<unsigned int>("--thumbnail-period") : 0U;
+	const Thumbnail thumbnail{grid_size, program.get<unsigned long>("--thumbnail")};
+	RegionSnapshots region_snapshots{regions, grid_size};
+	region_snapshots.attach(first_row, rank_rows, static_cast<MPI_Comm>(world));
+	RowBalancer row_balancer{program.get<unsigned int>("--rebalance"), program.get<double>("--rebalance-tolerance")};
+
+	// steps whose state is written or looked at
+	const auto observed = [&](uint step) {
+		return (snapshotting_period ? step % snapshotting_period == 0 : step == simulation_steps) || region_snapshots.due(step)
+			|| (thumbnail_period && step % thumbnail_period == 0) || (frame_period && step % frame_period == 0)
+			|| cycle_detector.observes(step);
+	};
+
+	std::unique_ptr<MetricsFile> metrics;
+	if (program.present("--metrics")) {
+		metrics = std::make_unique<MetricsFile>(*program.present("--metrics"), program.get<double>("--metrics-interval"),
+												simulation_steps, grid_size, static_cast<MPI_Comm>(world));
+	}
+	MetricsFile::Counters counters{0.0, 0.0, 0.0};
+	uint last_step = 0;
+	// false once a snapshot could not be written, which fails the run
+	bool written = true;
+
+	for (uint i = 1; i <= simulation_steps; i++) {
+		const double step_start = MPI_Wtime();
+		generations = 1;
+		if (evolver == evolve_blocked) {
+			for (; generations < time_block && i < simulation_steps && !observed(i); i++) {
+				generations++;
+			}
+		}
+		const double halo_start = communication_seconds();
+		{
+			Trace::Span span{"evolve"};
+			evolver(rank_chunk, next_step_chunk, world);
+		}
+		const double compute_seconds = MPI_Wtime() - step_start - (communication_seconds() - halo_start);
+		row_balancer.record(compute_seconds);
+		counters.compute_seconds += compute_seconds;
+		counters.communication_seconds = communication_seconds();
+		last_step = i;
+		if (!in_place) {
+			rank_chunk.swap(next_step_chunk);
+		}
+		const double write_start = MPI_Wtime();
+		if (snapshotting_period) {
+			if (i % snapshotting_period == 0) {
+				written = save_snapshot(rank_chunk, i, rank_file_offset_streampos, first_row, world, counters.bytes_written);
+			}
+		} else {
+			if (i == simulation_steps) {
+				written = save_snapshot(rank_chunk, i, rank_file_offset_streampos, first_row, world, counters.bytes_written);
+			}
+		}
+		region_snapshots.save(rank_chunk, i);
+		if (thumbnail_period && i % thumbnail_period == 0) {
+			thumbnail.save(compute_checkpoint_filename(i, "thumbnail_"), rank_chunk, first_row, world);
+		}
+		if (frame_period && i % frame_period == 0) {
+			Trace::Span span{"frame"};
+			frame_ring->publish(rank_chunk, first_row, i);
+		}
+		write_seconds += MPI_Wtime() - write_start;
+		if (!written) {
+			break;
+		}
+		const auto period = cycle_detector.observe(rank_chunk, row_stride, i, world);
+		if (period) {
+			ONE_RANK_PRINTS(0, "Grid is periodic with period " << period << " since step " << i - period);
+			// the state at any later step is the state at i plus the remainder modulo the period
+			const auto last_snapshot = snapshotting_period ? simulation_steps - simulation_steps % snapshotting_period : simulation_steps;
+			if (last_snapshot > i) {
+				generations = 1;
+				for (auto remaining = (last_snapshot - i) % period; remaining; remaining--) {
+					evolver(rank_chunk, next_step_chunk, world);
+					if (!in_place) {
+						rank_chunk.swap(next_step_chunk);
+					}
+				}
+				const double snapshot_start = MPI_Wtime();
+				written = save_snapshot(rank_chunk, last_snapshot, rank_file_offset_streampos, first_row, world, counters.bytes_written);
+				last_step = last_snapshot;
+				write_seconds += MPI_Wtime() - snapshot_start;
+			}
+			break;
+		}
+		if (row_balancer.rebalance(rank_chunk, next_step_chunk, first_row, grid_size, i, world)) {
+			ALL_RANKS_PRINT("rows " << first_row << "-" << first_row + rank_chunk.size() / row_stride - 3 << " after step " << i);
+			rank_file_offset_streampos = static_cast<std::streampos>(first_row * grid_size + header_length);
+			region_snapshots.attach(first_row, rank_chunk.size() / row_stride - 2, static_cast<MPI_Comm>(world));
+			if (halo) {
+				halo->attach(rank_chunk, next_step_chunk);
+			}
+			cycle_detector.reset();
+		}
+		if (metrics) {
+			metrics->observe(i, rank_chunk, counters);
+		}
+	}
+	if (uring_writer) {
+		const double drain_start = MPI_Wtime();
+		written = mpi::all_reduce(world, int(uring_writer->drain()), mpi::minimum<int>()) && written;
+		write_seconds += MPI_Wtime() - drain_start;
+	}
+	if (!written) {
+		error = "Cannot write the snapshots";
+		ONE_RANK_PRINTS(0, error << ". Quitting.");
+	}
+	if (metrics) {
+		metrics->finish(last_step, rank_chunk, counters);
+	}
+	double elapsed = timer.elapsed();
+	double avg = mpi::all_reduce(world, elapsed, std::plus<double>());
+	avg = avg / world.size();
+	double halo_avg = mpi::all_reduce(world, communication_seconds(), std::plus<double>());
+	halo_avg = halo_avg / world.size();
+	const auto huge_kb = mpi::all_reduce(world, MappedChunks::resident_huge_kb(), std::plus<unsigned long>());
+	const double read_avg = mpi::all_reduce(world, read_seconds, std::plus<double>()) / world.size();
+	const double write_avg = mpi::all_reduce(world, write_seconds, std::plus<double>()) / world.size();
+	if (!world.rank() && written) {
+		csv << grid_size << "," << world.size() << "," << nthreads << "," << avg << ","
+			<< (halo_exchange ? halo_exchange->name() : halo ? "engine" : "none") << "," << halo_avg << ","
+			<< (halo_memory ? halo->name() : chunk_backend_name) << "," << huge_kb << ","
+			<< read_avg << "," << write_avg << std::endl;
+	}
+	if (halo_memory) {
+		// the memory of these buffers goes away with the halo exchange
+		PGM_HOLDER{}.swap(rank_chunk);
+		PGM_HOLDER{}.swap(next_step_chunk);
+	}
+	halo_exchange = nullptr;
+	uring_writer = nullptr;
+	larger_than_life = nullptr;
+	for (auto& band : blocked_bands) {
+		PGM_HOLDER{}.swap(band);
+	}
+	return written ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 int main(int argc, char **argv)
@@ -250,11 +1066,38 @@ int main(int argc, char **argv)
 	const auto filename = program.get<std::string>("-f");
 	const auto ranks = world.size();
 
+	// outlive the chunks of the simulations and of the jobs
+	const auto memory = program.get<std::string>("--memory");
+	std::unique_ptr<MappedChunks> mapped_chunks;
+	std::unique_ptr<ChunkArena> chunk_arena;
+	if (memory == "thp" || memory == "hugetlb") {
+		mapped_chunks = std::make_unique<MappedChunks>(memory == "hugetlb");
+		chunk_backend = mapped_chunks.get();
+	} else if (memory != "heap") {
+		ONE_RANK_PRINTS(0, "Unknown chunk memory. Quitting.");
+		return EXIT_FAILURE;
+	}
+	chunk_backend_name = memory;
+	if (program["--arena"] == true) {
+		chunk_arena = std::make_unique<ChunkArena>(chunk_backend);
+		chunk_backend = chunk_arena.get();
+		chunk_backend_name += "+arena";
+	}
+
+	if (program.present("--trace")) {
+		Trace::start(program.get<unsigned long>("--trace-events"), static_cast<MPI_Comm>(world));
+	}
+
 	if (program["-i"] == true && program["-r"] == false) {
 		grid_size = program.get<unsigned long>("-k");
 		auto [rank_rows, rank_offset] = compute_rank_chunk_bounds(world);
 
-		PGM_HOLDER rank_random_chunk = PgmUtils::generate_random_chunk(rank_rows * grid_size);
+		const auto seed = program.present<unsigned long>("--seed");
+		std::mt19937_64 generator(seed ? *seed : std::random_device{}());
+		if (seed) {
+			generator.discard(rank_offset);
+		}
+		PGM_HOLDER rank_random_chunk = PgmUtils::generate_random_chunk(rank_rows, grid_size, generator);
 
 		if (!world.rank()) {
 			const SIZE_HOLDER dimensions{grid_size, grid_size};
@@ -266,80 +1109,152 @@ int main(int argc, char **argv)
 		world.barrier();
 		auto rank_file_offset = rank_offset + file_size;
 		std::streampos rank_file_offset_streampos = static_cast<std::streampos>(rank_file_offset);
-		PgmUtils::write_chunk_to_file(filename, rank_random_chunk, rank_file_offset_streampos, 0, static_cast<MPI_Comm>(world));
+		PgmUtils::write_chunk_to_file(filename, rank_random_chunk, rank_file_offset_streampos, grid_size, static_cast<MPI_Comm>(world));
 	} else if (program["-i"] == false && program["-r"] == true) {
-		uint header_length;
-
-		// Rank 0 reads the header
-		if (!world.rank()) {
-			std::ifstream infile(filename.c_str());
-			std::string line;
-			std::getline(infile, line);
-			std::istringstream iss(line);
-			header_length = uint(line.size()) + 1; // account for new line
-			std::string magic;
-			iss >> magic >> grid_size;
-		}
-
-		if (ranks != 1) {
-			broadcast(world, grid_size, 0);
-			broadcast(world, header_length, 0);
-			prev_rank = world.rank() - 1 >= 0 ? world.rank() - 1 : world.size() - 1;
-			next_rank = world.rank() + 1 >= world.size() ? 0 : world.rank() + 1;
-		}
-
+		PGM_HOLDER rank_chunk, next_step_chunk;
+		std::string error;
+		ret = run_simulation(program, world, rank_chunk, next_step_chunk, std::cout, error);
+	} else if (program["-i"] == false && program["-r"] == false && program.get<unsigned int>("--ensemble")) {
+		grid_size = program.get<unsigned long>("-k");
+		const auto universes = program.get<unsigned int>("--ensemble");
 		const auto simulation_steps = program.get<unsigned int>("-n");
-		const auto snapshotting_period = program.get<unsigned int>("-s");
-		const auto evolution_type = program.get<unsigned char>("-e");
-
-		void (*evolver)(PGM_HOLDER&, PGM_HOLDER&, mpi::communicator);
-		if (evolution_type == 1) {
-			evolver = evolve_static;
-		} else if (evolution_type == 0) {
-			evolver = evolve_ordered;
-		} else {
-			ONE_RANK_PRINTS(0, "Unknown evolution type. Quitting.");
-			ret = EXIT_FAILURE;
-			return ret;
+		const auto seed = program.present<unsigned long>("--seed");
+		std::uint64_t first_seed = seed ? *seed : 0;
+		if (!seed) {
+			if (!world.rank()) {
+				first_seed = std::random_device{}();
+			}
+			broadcast(world, first_seed, 0);
 		}
 
-		auto [rank_rows, rank_offset] = compute_rank_chunk_bounds(world);
-		auto rank_file_offset = rank_offset + header_length;
-		std::streampos rank_file_offset_streampos = static_cast<std::streampos>(rank_file_offset);
+		// batches of 64 universes dealt round-robin to the ranks; per universe: index, initial and
+		// final population, extinction and still step
 		mpi::timer timer;
-		PGM_HOLDER rank_chunk = PgmUtils::read_chunk_from_file(filename, rank_rows * grid_size, rank_file_offset_streampos, grid_size, static_cast<MPI_Comm>(world));
-		PGM_HOLDER next_step_chunk(rank_chunk.size());
-
-#pragma omp parallel
-{
-#pragma omp master
-{
-		nthreads = omp_get_num_threads();
-		for (uint i = 1; i <= simulation_steps; i++) {
-			evolver(rank_chunk, next_step_chunk, world);
-			rank_chunk.swap(next_step_chunk);
-			if (snapshotting_period) {
-				if (i % snapshotting_period == 0) {
-					save_snapshot(rank_chunk, i, rank_file_offset_streampos, world);
+		std::vector<unsigned long> rank_statistics;
+		const auto batches = (universes + ENSEMBLE_UNIVERSES - 1) / ENSEMBLE_UNIVERSES;
+		for (uint batch = world.rank(); batch < batches; batch += ranks) {
+			Ensemble ensemble{grid_size, first_seed + batch * ENSEMBLE_UNIVERSES};
+			for (uint i = 1; i <= simulation_steps && !ensemble.settled(); i++) {
+				ensemble.evolve();
+			}
+			const auto statistics = ensemble.statistics();
+			for (uint u = 0; u < ENSEMBLE_UNIVERSES && batch * ENSEMBLE_UNIVERSES + u < universes; u++) {
+				rank_statistics.insert(rank_statistics.end(), { batch * ENSEMBLE_UNIVERSES + u, statistics[u].initial_population,
+					statistics[u].final_population, statistics[u].extinction_step, statistics[u].still_step });
+			}
+		}
+		std::vector<std::vector<unsigned long>> all_statistics;
+		mpi::gather(world, rank_statistics, all_statistics, 0);
+		const double elapsed = timer.elapsed();
+		if (!world.rank()) {
+			std::vector<std::array<unsigned long, 5>> table;
+			for (const auto& statistics : all_statistics) {
+				for (std::size_t k = 0; k < statistics.size(); k += 5) {
+					table.push_back({ statistics[k], statistics[k + 1], statistics[k + 2], statistics[k + 3], statistics[k + 4] });
 				}
-			} else {
-				if (i == simulation_steps) {
-					save_snapshot(rank_chunk, i, rank_file_offset_streampos, world);
+			}
+			std::sort(table.begin(), table.end());
+			ONE_RANK_PRINTS(0, universes << " universes of " << grid_size << "x" << grid_size << " in " << elapsed << " s");
+			std::cout << "universe,seed,initial_population,final_population,extinction_step,still_step" << std::endl;
+			for (const auto& [universe, initial, final, extinction, still] : table) {
+				std::cout << universe << "," << first_seed + universe << "," << initial << "," << final << ","
+					<< extinction << "," << still << std::endl;
+			}
+		}
+	} else if (program["-i"] == false && program["-r"] == false && program.present("--export")) {
+		const auto source = *program.present("--export");
+		TiledGrid::Index index;
+		if (!TiledGrid::read_index(source, index)) {
+			ONE_RANK_PRINTS(0, "Cannot read " << source << ". Quitting.");
+			return EXIT_FAILURE;
+		}
+		if (program.present("--crop")) {
+			// a small area: rank 0 fetches the tiles it overlaps and writes it alone
+			const auto crop = *program.present("--crop");
+			unsigned long x, y, width, height;
+			char c1, c2, c3;
+			std::istringstream fields{crop};
+			fields >> x >> c1 >> y >> c2 >> width >> c3 >> height;
+			// >> would wrap negative numbers around into huge unsigned ones
+			if (crop.find('-') != std::string::npos || !fields || fields.peek() != EOF || c1 != ',' || c2 != ',' || c3 != ','
+				|| !width || !height || x >= index.width || width > index.width - x || y >= index.height || height > index.height - y) {
+				ONE_RANK_PRINTS(0, "Invalid crop. Quitting.");
+				return EXIT_FAILURE;
+			}
+			if (!world.rank()) {
+				std::vector<unsigned char> cells;
+				if (!TiledGrid::read_region(source, index, x, y, width, height, cells)) {
+					ONE_RANK_PRINTS(0, "Cannot read " << source << ". Quitting.");
+					return EXIT_FAILURE;
 				}
+				PgmUtils::write_header(filename, SIZE_HOLDER{width, height});
+				std::ofstream outstream{filename.c_str(), std::ios_base::binary | std::ios_base::app};
+				outstream.write(reinterpret_cast<const char*>(cells.data()), std::streamsize(cells.size()));
 			}
+		} else {
+			grid_size = index.width;
+			auto [rank_rows, rank_offset] = compute_rank_chunk_bounds(world);
+			std::vector<unsigned char> cells;
+			const bool read = TiledGrid::read_region(source, index, 0, rank_offset / grid_size, grid_size, rank_rows, cells);
+			if (!mpi::all_reduce(world, int(read), mpi::minimum<int>())) {
+				ONE_RANK_PRINTS(0, "Cannot read " << source << ". Quitting.");
+				return EXIT_FAILURE;
+			}
+			PGM_HOLDER rank_chunk = PgmUtils::allocate_chunk(rank_rows, grid_size);
+			const auto stride = PgmUtils::row_stride(grid_size);
+			for (auto row = 0UL; row < rank_rows; row++) {
+				std::copy_n(cells.data() + row * grid_size, grid_size, rank_chunk.data() + (row + 1) * stride + 1);
+			}
+			if (!world.rank()) {
+				const SIZE_HOLDER dimensions{grid_size, grid_size};
+				PgmUtils::write_header(filename, dimensions);
+			}
+			world.barrier();
+			const auto rank_file_offset = rank_offset + std::filesystem::file_size(filename);
+			world.barrier();
+			PgmUtils::write_chunk_to_file(filename, rank_chunk, static_cast<std::streampos>(rank_file_offset), grid_size, static_cast<MPI_Comm>(world));
 		}
-}
-}
-		double elapsed = timer.elapsed();
-		double avg = mpi::all_reduce(world, elapsed, std::plus<double>());
-		avg = avg / world.size();
-		if (!world.rank()){
-			std::cout << grid_size << "," << world.size() << "," << nthreads << "," << avg << std::endl;
+	} else if (program["-i"] == false && program["-r"] == false && program.present("--serve")) {
+		JobServer server{*program.present("--serve"), world};
+		if (!server.listening()) {
+			ONE_RANK_PRINTS(0, "Cannot listen on " << *program.present("--serve") << ". Quitting.");
+			return EXIT_FAILURE;
+		}
+		// the MPI world, the OpenMP threads and the chunks stay around from one job to the next
+		PGM_HOLDER rank_chunk, next_step_chunk;
+		for (auto job = server.next_job(); !job.empty(); job = server.next_job()) {
+			argparse::ArgumentParser job_program{"game_of_life"};
+			setup_parser(job_program);
+			std::vector<std::string> arguments{argv[0], "-r"};
+			std::istringstream words{job};
+			for (std::string word; words >> word;) {
+				arguments.push_back(word);
+			}
+			std::ostringstream csv;
+			try {
+				job_program.parse_args(arguments);
+				std::string error;
+				if (run_simulation(job_program, world, rank_chunk, next_step_chunk, csv, error) != EXIT_SUCCESS) {
+					csv << "error: " << error << std::endl;
+				}
+			} catch (const std::exception& err) {
+				csv << "error: " << err.what() << std::endl;
+			}
+			server.reply(csv.str());
 		}
 	} else {
 		ONE_RANK_PRINTS(0, "invalid arguments, quitting.");
 		ret = EXIT_FAILURE;
 	}
+	if (mapped_chunks && mapped_chunks->fallbacks()) {
+		ALL_RANKS_PRINT(mapped_chunks->fallbacks() << " chunks fell back from hugetlbfs to transparent huge pages");
+	}
+	if (chunk_arena) {
+		ALL_RANKS_PRINT(chunk_arena->hits() << " chunks reused by the arena");
+	}
+	if (program.present("--trace")) {
+		Trace::write(*program.present("--trace"), static_cast<MPI_Comm>(world));
+	}
 
 	return ret;
 }
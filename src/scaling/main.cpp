@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <argparse/argparse.hpp>
+
+#define TIMING_FIELDS	10 // at least, in the CSV line printed by gol -r
+#define SEED			1
+
+/*
+ * Strong and weak scaling studies of gol. Generates the inputs with gol -i, runs gol -r for every
+ * combination of ranks, threads and grid size the given number of times, and prints one CSV line
+ * per combination with the median seconds of every phase (the compute phase being what the load,
+ * the halo exchanges and the output leave of the total). Speedup, parallel efficiency and the
+ * Karp-Flatt serial fraction are relative to the combination with the fewest cores of the same
+ * series: the same grid size for strong scaling, the same cells per core for weak scaling, whose
+ * grid side grows with the square root of the cores. A combination with a failed run is left out;
+ * when it is the reference of its series, the other combinations of the series come without
+ * speedup, efficiency and serial fraction.
+ */
+
+struct Timing {
+	double seconds;
+	double halo_seconds;
+	double read_seconds;
+	double write_seconds;
+};
+
+struct Combination {
+	unsigned long grid_size;
+	unsigned long ranks;
+	unsigned long threads;
+	unsigned long series;
+};
+
+static std::vector<unsigned long> parse_list(const std::string& text)
+{
+	std::vector<unsigned long> values;
+	std::istringstream fields{text};
+	for (std::string field; std::getline(fields, field, ',');) {
+		values.push_back(std::stoul(field));
+	}
+	return values;
+}
+
+// runs command through the shell, returning its standard output, or false if it failed
+static bool run(const std::string& command, std::string& output)
+{
+	FILE *pipe = popen(command.c_str(), "r");
+	if (!pipe) {
+		return false;
+	}
+	output.clear();
+	char buffer[4096];
+	for (std::size_t read; (read = std::fread(buffer, 1, sizeof(buffer), pipe));) {
+		output.append(buffer, read);
+	}
+	const int status = pclose(pipe);
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// the last timing line of the output of gol -r; fields past TIMING_FIELDS, added by later versions, are ignored
+static bool parse_timing(const std::string& output, Timing& timing)
+{
+	std::istringstream lines{output};
+	bool found = false;
+	for (std::string line; std::getline(lines, line);) {
+		std::vector<std::string> fields;
+		std::istringstream cells{line};
+		for (std::string cell; std::getline(cells, cell, ',');) {
+			fields.push_back(cell);
+		}
+		if (fields.size() < TIMING_FIELDS || fields[0].empty() || fields[0].find_first_not_of("0123456789") != std::string::npos) {
+			continue;
+		}
+		try {
+			timing = { std::stod(fields[3]), std::stod(fields[5]), std::stod(fields[8]), std::stod(fields[9]) };
+			found = true;
+		} catch (const std::logic_error&) {
+			// a line that only looks like a timing line
+		}
+	}
+	return found;
+}
+
+static double median(std::vector<double> values)
+{
+	std::sort(values.begin(), values.end());
+	const auto middle = values.size() / 2;
+	return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+}
+
+static std::string replace_all(std::string text, const std::string& pattern, const std::string& value)
+{
+	for (auto at = text.find(pattern); at != std::string::npos; at = text.find(pattern, at + value.size())) {
+		text.replace(at, pattern.size(), value);
+	}
+	return text;
+}
+
+int main(int argc, char **argv)
+{
+	argparse::ArgumentParser program{"gol-scaling"};
+	program.add_argument("--ranks")
+		.default_value(std::string{"1"})
+		.help("comma-separated rank counts");
+	program.add_argument("--threads")
+		.default_value(std::string{"1"})
+		.help("comma-separated OpenMP thread counts per rank");
+	program.add_argument("--sizes")
+		.default_value(std::string{"1024"})
+		.help("comma-separated grid sizes (for weak scaling, at the fewest cores)");
+	program.add_argument("--weak")
+		.help("grow the grid with the cores instead of keeping it fixed")
+		.default_value(false)
+		.implicit_value(true);
+	program.add_argument("--repetitions")
+		.scan<'u', unsigned int>()
+		.default_value(3U)
+		.help("runs of every combination");
+	program.add_argument("-n")
+		.scan<'u', unsigned int>()
+		.default_value(100U)
+		.help("simulation steps of every run");
+	program.add_argument("--args")
+		.remaining()
+		.help("options of gol -r for every run, taking the rest of the command line [default: -e 1]");
+	program.add_argument("--gol")
+		.default_value(std::string{"./gol"})
+		.help("gol executable");
+	program.add_argument("--launcher")
+		.default_value(std::string{"mpirun -x OMP_NUM_THREADS -np {ranks}"})
+		.help("command prefix running gol on {ranks} ranks, OMP_NUM_THREADS being set in its environment");
+	program.add_argument("--workdir")
+		.default_value(std::string{"scaling"})
+		.help("directory of the inputs and of the snapshots of the runs");
+
+	try {
+		program.parse_args(argc, argv);
+	} catch (const std::runtime_error& err) {
+		std::cerr << err.what() << std::endl;
+		std::cerr << program;
+		return EXIT_FAILURE;
+	}
+
+	const auto all_ranks = parse_list(program.get<std::string>("--ranks"));
+	const auto all_threads = parse_list(program.get<std::string>("--threads"));
+	const auto sizes = parse_list(program.get<std::string>("--sizes"));
+	const bool weak = program["--weak"] == true;
+	const auto repetitions = program.get<unsigned int>("--repetitions");
+	const auto workdir = std::filesystem::absolute(program.get<std::string>("--workdir"));
+	const auto gol = std::filesystem::absolute(program.get<std::string>("--gol")).string();
+	const auto launcher = program.get<std::string>("--launcher");
+	std::string gol_arguments;
+	for (const auto& argument : program.present<std::vector<std::string>>("--args").value_or(std::vector<std::string>{"-e", "1"})) {
+		gol_arguments += " " + argument;
+	}
+	std::filesystem::create_directories(workdir);
+
+	// every series in increasing cores, so that its reference combination runs first
+	std::vector<Combination> combinations;
+	unsigned long fewest_cores = ULONG_MAX;
+	for (const auto ranks : all_ranks) {
+		for (const auto threads : all_threads) {
+			fewest_cores = std::min(fewest_cores, ranks * threads);
+		}
+	}
+	for (std::size_t series = 0; series < sizes.size(); series++) {
+		for (const auto ranks : all_ranks) {
+			for (const auto threads : all_threads) {
+				const double scale = weak ? std::sqrt(double(ranks * threads) / double(fewest_cores)) : 1.0;
+				combinations.push_back({ static_cast<unsigned long>(std::lround(double(sizes[series]) * scale)), ranks, threads, series });
+			}
+		}
+	}
+	std::stable_sort(combinations.begin(), combinations.end(), [](const Combination& a, const Combination& b) {
+		return a.series != b.series ? a.series < b.series : a.ranks * a.threads < b.ranks * b.threads;
+	});
+
+	std::map<unsigned long, std::string> inputs;
+	setenv("OMP_NUM_THREADS", "1", 1);
+	for (const auto& combination : combinations) {
+		if (inputs.count(combination.grid_size)) {
+			continue;
+		}
+		const auto input = (workdir / ("input_" + std::to_string(combination.grid_size) + ".pgm")).string();
+		std::string output;
+		if (!std::filesystem::exists(input) && !run("cd " + workdir.string() + " && " + replace_all(launcher, "{ranks}", "1") + " " + gol
+				+ " -i -k " + std::to_string(combination.grid_size) + " --seed " + std::to_string(SEED) + " -f " + input, output)) {
+			std::cerr << "Cannot generate " << input << std::endl;
+			return EXIT_FAILURE;
+		}
+		inputs[combination.grid_size] = input;
+	}
+
+	std::cout << "scaling,series,grid_size,ranks,threads,cores,repetitions,seconds,read_seconds,compute_seconds,halo_seconds,"
+		"write_seconds,min_seconds,max_seconds,speedup,efficiency,karp_flatt" << std::endl;
+	// seconds and cores of the first combination of every series, no seconds if it failed
+	std::map<unsigned long, std::pair<double, unsigned long>> references;
+	for (const auto& combination : combinations) {
+		setenv("OMP_NUM_THREADS", std::to_string(combination.threads).c_str(), 1);
+		const auto command = "cd " + workdir.string() + " && " + replace_all(launcher, "{ranks}", std::to_string(combination.ranks))
+			+ " " + gol + " -r -f " + inputs[combination.grid_size] + " -n " + std::to_string(program.get<unsigned int>("-n")) + " -s 0"
+			+ gol_arguments;
+		const auto cores = combination.ranks * combination.threads;
+		std::vector<double> seconds, read, compute, halo, write;
+		for (unsigned int repetition = 0; repetition < repetitions; repetition++) {
+			std::string output;
+			Timing timing;
+			if (!run(command, output) || !parse_timing(output, timing)) {
+				std::cerr << "Failed: " << command << std::endl;
+				seconds.clear();
+				break;
+			}
+			seconds.push_back(timing.seconds);
+			read.push_back(timing.read_seconds);
+			halo.push_back(timing.halo_seconds);
+			write.push_back(timing.write_seconds);
+			compute.push_back(timing.seconds - timing.read_seconds - timing.halo_seconds - timing.write_seconds);
+		}
+		const bool reference = !references.count(combination.series);
+		if (seconds.empty()) {
+			std::cerr << "Skipped grid " << combination.grid_size << " on " << combination.ranks << " ranks of "
+				<< combination.threads << " threads after a failed run";
+			if (reference) {
+				std::cerr << "; series " << combination.series << " has no reference for its speedups";
+				references[combination.series] = { 0.0, cores };
+			}
+			std::cerr << std::endl;
+			continue;
+		}
+		const double time = median(seconds);
+		if (reference) {
+			references[combination.series] = { time, cores };
+		}
+		const auto [reference_time, reference_cores] = references[combination.series];
+		// relative cores, and the speedup over the reference (scaled by the growth of the grid when weak)
+		const double p = double(cores) / double(reference_cores);
+		const double speedup = reference_time / time * (weak ? p : 1.0);
+		std::cout << (weak ? "weak" : "strong") << "," << combination.series << "," << combination.grid_size << ","
+			<< combination.ranks << "," << combination.threads << "," << cores << "," << seconds.size() << ","
+			<< time << "," << median(read) << "," << median(compute) << "," << median(halo) << "," << median(write) << ","
+			<< *std::min_element(seconds.begin(), seconds.end()) << "," << *std::max_element(seconds.begin(), seconds.end()) << ",";
+		if (reference_time) {
+			std::cout << speedup << "," << speedup / p << ",";
+			if (p > 1) {
+				std::cout << (1 / speedup - 1 / p) / (1 - 1 / p);
+			}
+		} else {
+			std::cout << ",,";
+		}
+		std::cout << std::endl;
+	}
+	return EXIT_SUCCESS;
+}